@@ -0,0 +1,860 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "backend.h"
+#include "check.h"
+#include "clock.h"
+#include "history.h"
+#include "log.h"
+#include "service.h"
+#include "shared.h"
+#include "trace.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+#define SECS_PER_HOUR 3600L
+
+/* Number of consecutive failed checks after which the last known result is hidden */
+#define MAX_CHECK_ERRORS 3
+
+/* With no periodic checks, a result shared by another panel within this time */
+/* is used instead of checking - otherwise it is used if it is within the     */
+/* check interval, so only one panel checks in each interval                 */
+#define SHARED_FRESH_US (30 * 60 * (gint64) G_USEC_PER_SEC)
+
+/* Minimum time between notifications for each class of update */
+#define NOTIFY_INTERVAL_SECURITY (1 * SECS_PER_HOUR * (gint64) G_USEC_PER_SEC)
+#define NOTIFY_INTERVAL_OTHER (24 * SECS_PER_HOUR * (gint64) G_USEC_PER_SEC)
+
+/* Checks an interval apart do not finish exactly an interval apart, as one */
+/* refresh can be quicker than the last, so a notification is allowed this  */
+/* much before its interval is up                                           */
+#define NOTIFY_SLACK(interval) ((interval) / 8)
+
+/* Callbacks on the main thread which take longer than this are logged as stalls */
+#define STALL_THRESHOLD_US 50000
+
+/* Client errors from a failed transaction are the PackageKit error code offset by this */
+#define PK_ERROR_OFFSET 0xff
+
+struct _Backend
+{
+    BackendFuncs funcs;             /* Callbacks to whatever shows the result */
+    gpointer user_data;
+    UpdateSet *updates;             /* Result of the last successful check - replaced, never modified, main thread only */
+    UpdateSet *notified;            /* Updates which were pending when the user was last notified */
+    int interval;                   /* Number of hours between periodic checks */
+    gboolean isolate;               /* Whether to run checks in the helper process */
+    char *prom_file;                /* Path of Prometheus textfile to write, or NULL */
+    guint timer;                    /* Periodic check timer ID */
+    guint idle_timer;
+    Check *check;                   /* Check in progress, or NULL */
+    gboolean check_refresh;         /* Whether the check in progress refreshes the cache */
+    UpdaterState prev_state;        /* State to restore if the check in progress is cancelled */
+    Service *service;               /* Session bus service publishing the result */
+    Shared *shared;                 /* Result shared with the other panels on the machine */
+    gint64 last_notify[UPD_N_CLASSES];  /* Monotonic time of last notification for each class */
+    gint64 check_start;             /* Wall clock time at which the current check started */
+    gint64 phase_mark;              /* Monotonic time at which the current phase started */
+    gint64 phase_us[N_PHASES];      /* Duration of each phase of the current check */
+    guint phase_done;               /* Bitmask of phases completed by the current check */
+    UpdaterHistogram phase_hist[N_PHASES];  /* Duration histograms for each phase */
+    guint n_checks;                 /* Number of checks completed */
+    guint n_check_errors;           /* Number of checks which failed */
+    gint64 last_success;            /* Wall clock time of the last successful check */
+    char *prom_last;                /* Contents last written to the Prometheus textfile */
+    gint64 install_start;           /* Wall clock time at which the installer was launched */
+    guint install_watch;            /* Child watch ID for running installer */
+    UpdateSet *install_set;         /* Updates which were pending when the installer was launched */
+    guint watch_depth;              /* Number of timed callbacks currently running, one inside another */
+    guint n_callbacks;              /* Number of callbacks timed on the main thread */
+    gint64 callback_us;             /* Total time spent in those callbacks */
+    guint n_stalls;                 /* Number of callbacks which took longer than the stall threshold */
+    gint64 stall_max_us;            /* Duration of the longest stall */
+    const char *stall_worst;        /* Name of the callback which caused the longest stall */
+    char *record_path;              /* File to which the next check is recorded */
+    Replay *replay;                 /* Recorded check which is replayed instead of using PackageKit */
+    double replay_speed;            /* Speed-up factor for replayed checks */
+    UpdaterState state;             /* Current state */
+    int n_errors;                   /* Number of consecutive failed checks */
+};
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+static const char *phase_names[N_PHASES] = { "spawn", "refresh", "query", "filter", "ui" };
+static const char *state_names[] = { "unknown", "checking", "up-to-date", "updates", "error" };
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static void mark_phase (Backend *be, UpdaterPhase phase);
+static void hist_add (UpdaterHistogram *hist, gint64 us);
+static void record_check (Backend *be, int error);
+static void write_prom_file (Backend *be, gint64 duration);
+static void service_check (gboolean refresh, gpointer user_data);
+static void publish_state (Backend *be);
+static void check_for_updates (Backend *be);
+static void check_done (Replay *rep, gboolean cancelled, gpointer user_data);
+static const char *error_name (int code);
+static void check_failed (Backend *be, int code, const char *what);
+static void process_updates (Backend *be, PkPackageSack *sack);
+static void set_updates (Backend *be, UpdateSet *set, int new_security, int new_other);
+static gboolean notify_due (Backend *be, UpdaterClass cls, gint64 interval, gint64 now);
+static void notify_updates (Backend *be, int new_security, int new_other);
+static void shared_result (const SharedResult *res, gpointer user_data);
+static void record_trace (Backend *be, const Replay *rep);
+static void installer_done (GPid pid, gint status, gpointer user_data);
+static void set_state (Backend *be, UpdaterState state);
+static gboolean init_check (gpointer data);
+static gboolean net_check (gpointer data);
+static gboolean periodic_check (gpointer data);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Main loop stall detection                                                  */
+/*----------------------------------------------------------------------------*/
+
+/* Only the outermost timed callback is counted - those it calls are part of */
+/* it. This measures real work, so it uses the system clock                  */
+BackendWatch backend_watch_begin (Backend *be, const char *name)
+{
+    BackendWatch watch = { be, name, 0 };
+
+    if (!be->watch_depth++) watch.start = g_get_monotonic_time ();
+    return watch;
+}
+
+void backend_watch_end (BackendWatch *watch)
+{
+    Backend *be = watch->be;
+    gint64 us;
+
+    if (--be->watch_depth) return;
+    us = g_get_monotonic_time () - watch->start;
+
+    be->n_callbacks++;
+    be->callback_us += us;
+    if (us < STALL_THRESHOLD_US) return;
+
+    be->n_stalls++;
+    if (us > be->stall_max_us)
+    {
+        be->stall_max_us = us;
+        be->stall_worst = watch->name;
+    }
+    WARN ("Main loop stall - %s took %" G_GINT64_FORMAT "ms", watch->name, us / 1000);
+    TRACE2 (stall, watch->name, us);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Check timing and history                                                   */
+/*----------------------------------------------------------------------------*/
+
+static void mark_phase (Backend *be, UpdaterPhase phase)
+{
+    gint64 now = clock_monotonic ();
+
+    be->phase_us[phase] = now - be->phase_mark;
+    be->phase_done |= 1 << phase;
+    be->phase_mark = now;
+}
+
+static void hist_add (UpdaterHistogram *hist, gint64 us)
+{
+    gint64 ms = us / 1000;
+    int bucket = 0;
+
+    while (ms && bucket < N_HIST_BUCKETS - 1)
+    {
+        ms >>= 1;
+        bucket++;
+    }
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->total_us += us;
+    if (us > hist->max_us) hist->max_us = us;
+}
+
+/* error is the PackageKit error code of a failed check, or REPLAY_OK */
+static void record_check (Backend *be, int error)
+{
+    HistoryRecord rec;
+    int i;
+
+    /* histograms are only touched here, on the main thread */
+    for (i = 0; i < N_PHASES; i++)
+        if (be->phase_done & (1 << i)) hist_add (&be->phase_hist[i], be->phase_us[i]);
+
+    memset (&rec, 0, sizeof (HistoryRecord));
+    rec.type = HISTORY_CHECK;
+    rec.start = be->check_start;
+    rec.end = clock_real ();
+    for (i = 0; i < N_PHASES && i < HISTORY_MAX_PHASES; i++)
+        rec.phase_ms[i] = be->phase_us[i] / 1000;
+
+    be->n_checks++;
+    if (error != REPLAY_OK)
+    {
+        rec.error = 1;
+        rec.status = error;
+        be->n_check_errors++;
+    }
+    else
+    {
+        rec.n_updates = MIN (be->updates->n_updates, G_MAXUINT16);
+        rec.n_security = MIN (be->updates->n_security, G_MAXUINT16);
+        rec.fingerprint = be->updates->fingerprint;
+        be->last_success = rec.end;
+    }
+    history_append (&rec);
+    write_prom_file (be, rec.end - rec.start);
+    TRACE3 (check__end, rec.n_updates, rec.end - rec.start, error != REPLAY_OK ? error : 0);
+    publish_state (be);
+}
+
+/* Metrics for the node_exporter textfile collector - the file is replaced */
+/* atomically, and only rewritten if its contents would change             */
+static void write_prom_file (Backend *be, gint64 duration)
+{
+    char *buf;
+
+    if (!be->prom_file || !*be->prom_file) return;
+
+    buf = g_strdup_printf (
+        "# HELP updater_pending_updates Number of pending updates by class.\n"
+        "# TYPE updater_pending_updates gauge\n"
+        "updater_pending_updates{class=\"security\"} %d\n"
+        "updater_pending_updates{class=\"other\"} %d\n"
+        "# HELP updater_last_success_timestamp_seconds Time of the last successful check.\n"
+        "# TYPE updater_last_success_timestamp_seconds gauge\n"
+        "updater_last_success_timestamp_seconds %" G_GINT64_FORMAT "\n"
+        "# HELP updater_check_duration_seconds Duration of the last check.\n"
+        "# TYPE updater_check_duration_seconds gauge\n"
+        "updater_check_duration_seconds %.1f\n"
+        "# HELP updater_checks_total Number of checks completed.\n"
+        "# TYPE updater_checks_total counter\n"
+        "updater_checks_total %u\n"
+        "# HELP updater_check_errors_total Number of checks which failed.\n"
+        "# TYPE updater_check_errors_total counter\n"
+        "updater_check_errors_total %u\n",
+        be->updates->n_security, be->updates->n_updates - be->updates->n_security, be->last_success / G_USEC_PER_SEC,
+        duration / (double) G_USEC_PER_SEC, be->n_checks, be->n_check_errors);
+
+    if (g_strcmp0 (buf, be->prom_last))
+    {
+        if (g_file_set_contents (be->prom_file, buf, -1, NULL))
+        {
+            g_free (be->prom_last);
+            be->prom_last = buf;
+            return;
+        }
+        WARN ("Unable to write metrics to %s", be->prom_file);
+    }
+    g_free (buf);
+}
+
+/* Resource usage of the process, so that leaks show up over time */
+void backend_resources (long *rss_kb, int *n_fds, int *n_threads)
+{
+    GDir *dir;
+    char *buf, *ptr;
+    long pages;
+
+    *rss_kb = *n_fds = *n_threads = -1;
+
+    if (g_file_get_contents ("/proc/self/statm", &buf, NULL, NULL))
+    {
+        if (sscanf (buf, "%*ld %ld", &pages) == 1) *rss_kb = pages * (sysconf (_SC_PAGESIZE) / 1024);
+        g_free (buf);
+    }
+
+    if (g_file_get_contents ("/proc/self/status", &buf, NULL, NULL))
+    {
+        ptr = strstr (buf, "Threads:");
+        if (ptr) *n_threads = atoi (ptr + 8);
+        g_free (buf);
+    }
+
+    dir = g_dir_open ("/proc/self/fd", 0, NULL);
+    if (dir)
+    {
+        *n_fds = 0;
+        while (g_dir_read_name (dir)) (*n_fds)++;
+        g_dir_close (dir);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Session bus service                                                        */
+/*----------------------------------------------------------------------------*/
+
+static void service_check (gboolean refresh, gpointer user_data)
+{
+    Backend *be = (Backend *) user_data;
+    WATCH (be);
+    backend_check (be, refresh);
+}
+
+static void publish_state (Backend *be)
+{
+    service_update (be->service, state_names[be->state], be->updates, be->last_success / G_USEC_PER_SEC);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Check pipeline                                                             */
+/*----------------------------------------------------------------------------*/
+
+static void check_for_updates (Backend *be)
+{
+    gint64 max_age = be->interval ? (gint64) be->interval * SECS_PER_HOUR * G_USEC_PER_SEC : SHARED_FRESH_US;
+
+    /* another panel may have checked this interval - its result is as good as a */
+    /* new one, but this panel's own result from the last tick is not            */
+    if (!be->replay && !be->check && shared_read (be->shared, max_age)) return;
+    backend_check (be, TRUE);
+}
+
+/* Every check ends here, however it was run - the check times its own */
+/* PackageKit calls, and the rest is starting and ending the check     */
+static void check_done (Replay *rep, gboolean cancelled, gpointer user_data)
+{
+    Backend *be = (Backend *) user_data;
+    gint64 now;
+    WATCH (be);
+
+    be->check = NULL;
+
+    /* a cancelled check is not a failure - the state goes back to how it was */
+    if (cancelled)
+    {
+        INFO ("Check cancelled");
+        shared_release (be->shared);
+        if (be->prev_state == UPD_STATE_ERROR) be->n_errors--;
+        set_state (be, be->prev_state);
+        return;
+    }
+
+    if (!rep)
+    {
+        mark_phase (be, PHASE_SPAWN);
+        ERR ("Error running check helper");
+        set_state (be, UPD_STATE_ERROR);
+        record_check (be, PK_CLIENT_ERROR_FAILED);
+        shared_release (be->shared);
+        return;
+    }
+
+    now = clock_monotonic ();
+    be->phase_us[PHASE_SPAWN] = MAX (now - be->phase_mark - rep->refresh_us - rep->query_us, 0);
+    be->phase_us[PHASE_REFRESH] = rep->refresh_us;
+    be->phase_us[PHASE_QUERY] = rep->query_us;
+    be->phase_done |= 1 << PHASE_SPAWN;
+    if (be->check_refresh)
+    {
+        be->phase_done |= 1 << PHASE_REFRESH;
+        TRACE2 (refresh__done, rep->refresh_us, rep->refresh_error != REPLAY_OK);
+    }
+    if (rep->refresh_error == REPLAY_OK)
+    {
+        be->phase_done |= 1 << PHASE_QUERY;
+        TRACE2 (get__updates__done, rep->query_us, rep->query_error != REPLAY_OK);
+    }
+    be->phase_mark = now;
+
+    record_trace (be, rep);
+    if (rep->refresh_error != REPLAY_OK) check_failed (be, rep->refresh_error, "updating cache");
+    else if (rep->query_error != REPLAY_OK) check_failed (be, rep->query_error, "comparing versions");
+    else process_updates (be, rep->sack);
+
+    /* only the leader publishes, so the lock is held until the result is written */
+    shared_release (be->shared);
+}
+
+static const char *error_name (int code)
+{
+    if (code > PK_ERROR_OFFSET) return pk_error_enum_to_string (code - PK_ERROR_OFFSET);
+    return "client error";
+}
+
+static void check_failed (Backend *be, int code, const char *what)
+{
+    ERR ("Error %s - %s (%d)", what, error_name (code), code);
+    set_state (be, UPD_STATE_ERROR);
+    record_check (be, code);
+}
+
+/* Filter and classify the results of a check, and update the state */
+static void process_updates (Backend *be, PkPackageSack *sack)
+{
+    UpdateSet *set;
+    int new_security, new_other;
+
+    set = update_set_new (sack, be->notified, &new_security, &new_other);
+    set_updates (be, set, new_security, new_other);
+    mark_phase (be, PHASE_FILTER);
+    TRACE3 (filter__done, be->updates->n_updates, be->updates->n_security, be->phase_us[PHASE_FILTER]);
+    set_state (be, be->updates->n_updates > 0 ? UPD_STATE_UPDATES : UPD_STATE_UP_TO_DATE);
+    mark_phase (be, PHASE_UI);
+    record_check (be, REPLAY_OK);
+    shared_publish (be->shared, be->updates, be->last_success);
+}
+
+/* Replace the current set of updates, and notify any not yet notified. The */
+/* current set is only read and replaced on the main thread, so it is a    */
+/* plain pointer - the old set is only freed once every holder which took  */
+/* a reference to it has dropped that reference                            */
+static void set_updates (Backend *be, UpdateSet *set, int new_security, int new_other)
+{
+    update_set_unref (be->updates);
+    be->updates = set;
+
+    if (set->n_updates > 0)
+    {
+        INFO ("Check complete - %d updates available (%d security, %d not notified)", set->n_updates, set->n_security, new_security + new_other);
+        notify_updates (be, new_security, new_other);
+    }
+    else
+    {
+        INFO ("Check complete - no updates available");
+        if (be->funcs.notify_clear) be->funcs.notify_clear (be->user_data);
+
+        /* nothing is pending, so anything which appears later is new */
+        update_set_unref (be->notified);
+        be->notified = update_set_ref (set);
+    }
+}
+
+static gboolean notify_due (Backend *be, UpdaterClass cls, gint64 interval, gint64 now)
+{
+    return !be->last_notify[cls] || now - be->last_notify[cls] >= interval - NOTIFY_SLACK (interval);
+}
+
+/* Only updates which have not been notified are notified, rate-limited per  */
+/* class, and each notification replaces the previous one rather than       */
+/* stacking up. New updates are counted against the set last notified, not  */
+/* the set last checked, so a notification held back by the rate limit is   */
+/* only delayed - the updates stay new until a notification is shown        */
+static void notify_updates (Backend *be, int new_security, int new_other)
+{
+    gint64 now = clock_monotonic ();
+    gboolean security;
+
+    if (!new_security && !new_other) return;
+
+    if (new_security && notify_due (be, UPD_CLASS_SECURITY, NOTIFY_INTERVAL_SECURITY, now))
+    {
+        /* this also announces any other new updates, so counts as a notification of both */
+        security = TRUE;
+        be->last_notify[UPD_CLASS_SECURITY] = now;
+        be->last_notify[UPD_CLASS_OTHER] = now;
+    }
+    else if (notify_due (be, UPD_CLASS_OTHER, NOTIFY_INTERVAL_OTHER, now))
+    {
+        security = FALSE;
+        be->last_notify[UPD_CLASS_OTHER] = now;
+    }
+    else
+    {
+        DEBUG ("Notification of %d new updates delayed by rate limit", new_security + new_other);
+        return;
+    }
+
+    if (be->funcs.notify) be->funcs.notify (security, be->user_data);
+    TRACE2 (notify, new_security, new_other);
+
+    update_set_unref (be->notified);
+    be->notified = update_set_ref (be->updates);
+}
+
+/* A result written by another panel is used as if this panel had checked */
+static void shared_result (const SharedResult *res, gpointer user_data)
+{
+    Backend *be = (Backend *) user_data;
+    UpdateSet *set;
+    int new_security, new_other;
+    WATCH (be);
+
+    if (be->check) return;
+    set = update_set_new_from_ids (res->ids, res->security, res->n_updates, be->notified, &new_security, &new_other);
+    set_updates (be, set, new_security, new_other);
+    be->last_success = res->written;
+    set_state (be, be->updates->n_updates > 0 ? UPD_STATE_UPDATES : UPD_STATE_UP_TO_DATE);
+}
+
+/* Save the outcome of the current check if one was requested by backend_record */
+static void record_trace (Backend *be, const Replay *rep)
+{
+    if (!be->record_path) return;
+
+    if (replay_save (be->record_path, rep)) INFO ("Check recorded to %s", be->record_path);
+    else WARN ("Unable to record check to %s", be->record_path);
+
+    g_free (be->record_path);
+    be->record_path = NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Installer                                                                  */
+/*----------------------------------------------------------------------------*/
+
+static void installer_done (GPid pid, gint status, gpointer user_data)
+{
+    Backend *be = (Backend *) user_data;
+    HistoryRecord rec;
+    WATCH (be);
+
+    g_spawn_close_pid (pid);
+    be->install_watch = 0;
+
+    memset (&rec, 0, sizeof (HistoryRecord));
+    rec.type = HISTORY_INSTALL;
+    rec.error = !g_spawn_check_wait_status (status, NULL);
+    rec.status = status;
+    rec.start = be->install_start;
+    rec.end = clock_real ();
+    rec.n_updates = MIN (be->install_set->n_updates, G_MAXUINT16);
+    rec.n_security = MIN (be->install_set->n_security, G_MAXUINT16);
+    rec.fingerprint = be->install_set->fingerprint;
+    history_append (&rec);
+
+    update_set_unref (be->install_set);
+    be->install_set = NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Scheduler                                                                  */
+/*----------------------------------------------------------------------------*/
+
+static void set_state (Backend *be, UpdaterState state)
+{
+    be->state = state;
+    if (state == UPD_STATE_ERROR) be->n_errors++;
+    else if (state != UPD_STATE_CHECKING) be->n_errors = 0;
+    publish_state (be);
+    if (be->funcs.changed) be->funcs.changed (be->user_data);
+}
+
+static gboolean init_check (gpointer data)
+{
+    Backend *be = (Backend *) data;
+    WATCH (be);
+    be->idle_timer = 0;
+
+    /* created here rather than with the backend, as they talk to the session */
+    /* bus and touch the filesystem - nothing does until the first idle      */
+    be->service = service_new (service_check, be);
+    be->shared = shared_new (shared_result, be);
+    publish_state (be);
+
+    /* Don't bother with the check if the wizard is running - it checks anyway... */
+    if (check_wizard_running ()) return FALSE;
+
+    if (be->replay || check_net_available ()) check_for_updates (be);
+    else
+    {
+        DEBUG ("No network connection - polling...");
+        be->idle_timer = clock_timeout_add_seconds (60, net_check, be);
+    }
+    return FALSE;
+}
+
+static gboolean net_check (gpointer data)
+{
+    Backend *be = (Backend *) data;
+    WATCH (be);
+    if (check_net_available ())
+    {
+        be->idle_timer = 0;
+        check_for_updates (be);
+        return FALSE;
+    }
+    DEBUG ("No network connection - polling...");
+    return TRUE;
+}
+
+static gboolean periodic_check (gpointer data)
+{
+    Backend *be = (Backend *) data;
+    WATCH (be);
+    check_for_updates (be);
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Public functions                                                           */
+/*----------------------------------------------------------------------------*/
+
+/* Nothing is checked, and nothing outside the process is touched, until the */
+/* main loop runs the first idle                                             */
+Backend *backend_new (const BackendFuncs *funcs, gpointer user_data)
+{
+    Backend *be = g_new0 (Backend, 1);
+
+    if (funcs) be->funcs = *funcs;
+    be->user_data = user_data;
+    be->updates = update_set_new (NULL, NULL, NULL, NULL);
+    be->notified = update_set_ref (be->updates);
+    be->replay_speed = 1.0;
+    be->state = UPD_STATE_UNKNOWN;
+    be->idle_timer = clock_idle_add (init_check, be);
+    return be;
+}
+
+void backend_free (Backend *be)
+{
+    if (be->timer) clock_source_remove (be->timer);
+    if (be->idle_timer) clock_source_remove (be->idle_timer);
+    if (be->install_watch) g_source_remove (be->install_watch);
+    update_set_unref (be->install_set);
+
+    /* a check in progress is cancelled and detached, and ends by itself */
+    if (be->check)
+    {
+        check_detach (be->check);
+        shared_release (be->shared);
+    }
+    service_free (be->service);
+    shared_free (be->shared);
+    replay_free (be->replay);
+    g_free (be->record_path);
+    update_set_unref (be->updates);
+    update_set_unref (be->notified);
+    g_free (be->prom_file);
+    g_free (be->prom_last);
+    g_free (be);
+}
+
+/* An interval of 0 turns periodic checks off */
+void backend_set_interval (Backend *be, int hours)
+{
+    if (hours == be->interval && (be->timer || !hours)) return;
+    if (be->timer) clock_source_remove (be->timer);
+    be->interval = hours;
+    if (hours)
+        be->timer = clock_timeout_add_seconds (hours * SECS_PER_HOUR, periodic_check, be);
+    else
+        be->timer = 0;
+}
+
+void backend_set_isolate (Backend *be, gboolean isolate)
+{
+    be->isolate = isolate;
+}
+
+void backend_set_prom_file (Backend *be, const char *path)
+{
+    g_free (be->prom_file);
+    be->prom_file = g_strdup (path);
+}
+
+/* Replay a recorded check in place of every check - the backend owns rep */
+void backend_set_replay (Backend *be, Replay *rep, double speed)
+{
+    replay_free (be->replay);
+    be->replay = rep;
+    be->replay_speed = speed;
+}
+
+/* Checks are single-flight - a request while one is running joins it */
+void backend_check (Backend *be, gboolean refresh)
+{
+    if (be->check)
+    {
+        DEBUG ("Check already in progress");
+        return;
+    }
+
+    if (refresh && !be->replay && !check_net_available ())
+    {
+        INFO ("No network connection - update check failed");
+        return;
+    }
+
+    if (!be->replay && !shared_lead (be->shared))
+    {
+        DEBUG ("Another panel is checking - waiting for its result");
+        return;
+    }
+
+    INFO ("Checking for updates");
+    be->prev_state = be->state;
+    be->check_refresh = refresh;
+    set_state (be, UPD_STATE_CHECKING);
+    be->check_start = clock_real ();
+    be->phase_mark = clock_monotonic ();
+    memset (be->phase_us, 0, sizeof (be->phase_us));
+    be->phase_done = 0;
+    TRACE (check__start);
+
+    be->check = check_start (refresh, be->isolate, be->replay, be->replay_speed, check_done, be);
+}
+
+/* The check ends, as cancelled, when the thread or helper finishes */
+void backend_cancel (Backend *be)
+{
+    if (be->check) check_cancel (be->check);
+}
+
+void backend_record (Backend *be, const char *path)
+{
+    g_free (be->record_path);
+    be->record_path = g_strdup (path);
+}
+
+/* The history records what was pending when the installer was launched, */
+/* even if a check replaces the set while it runs                          */
+void backend_install (Backend *be, UpdateSet *set)
+{
+    char *cmd[2] = {"gui-updater", NULL};
+    GPid pid;
+
+    if (be->install_watch) return;
+    if (!g_spawn_async (NULL, cmd, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, &pid, NULL)) return;
+
+    be->install_start = clock_real ();
+    be->install_set = update_set_ref (set);
+    be->install_watch = g_child_watch_add (pid, installer_done, be);
+}
+
+UpdaterState backend_get_state (Backend *be)
+{
+    return be->state;
+}
+
+/* The set is only valid until the current callback returns */
+const UpdateSet *backend_get_updates (Backend *be)
+{
+    return be->updates;
+}
+
+/* Holders which keep the set beyond the current callback take a reference */
+UpdateSet *backend_ref_updates (Backend *be)
+{
+    return update_set_ref (be->updates);
+}
+
+/* Whether there are updates to show - while checking, and for a few failed */
+/* checks, the last known result is kept. Once it has been hidden for too   */
+/* many failures, a new check does not show it again until one succeeds     */
+gboolean backend_result_visible (Backend *be)
+{
+    switch (be->state)
+    {
+        case UPD_STATE_UPDATES:     return TRUE;
+
+        case UPD_STATE_CHECKING:
+        case UPD_STATE_ERROR:       return be->updates->n_updates > 0 && be->n_errors < MAX_CHECK_ERRORS;
+
+        default:                    return FALSE;
+    }
+}
+
+gboolean backend_checking (Backend *be)
+{
+    return be->check != NULL;
+}
+
+gboolean backend_installing (Backend *be)
+{
+    return be->install_watch != 0;
+}
+
+void backend_get_counts (Backend *be, guint *n_checks, guint *n_errors)
+{
+    if (n_checks) *n_checks = be->n_checks;
+    if (n_errors) *n_errors = be->n_check_errors;
+}
+
+const UpdaterHistogram *backend_get_histogram (Backend *be, UpdaterPhase phase)
+{
+    return &be->phase_hist[phase];
+}
+
+void backend_status (Backend *be, GString *str)
+{
+    g_string_append_printf (str, "state=%s updates=%d security=%d last_check=%" G_GINT64_FORMAT " fingerprint=%016" G_GINT64_MODIFIER "x checking=%s\n",
+        state_names[be->state], be->updates->n_updates, be->updates->n_security, be->last_success / G_USEC_PER_SEC,
+        be->updates->fingerprint, be->check ? "yes" : "no");
+}
+
+void backend_json (Backend *be, GString *str)
+{
+    g_string_append_printf (str, "{\"state\":\"%s\",\"count\":%d,\"security\":%d,\"last_check\":%" G_GINT64_FORMAT ",\"fingerprint\":\"%016" G_GINT64_MODIFIER "x\",\"updates\":",
+        state_names[be->state], be->updates->n_updates, be->updates->n_security, be->last_success / G_USEC_PER_SEC, be->updates->fingerprint);
+    update_set_append_json (be->updates, str);
+    g_string_append (str, "}\n");
+}
+
+/* One line per phase histogram, then main loop and resource usage */
+void backend_stats (Backend *be, GString *str)
+{
+    const UpdaterHistogram *hist;
+    long rss_kb;
+    int n_fds, n_threads;
+    int i, b;
+
+    for (i = 0; i < N_PHASES; i++)
+    {
+        hist = &be->phase_hist[i];
+        g_string_append_printf (str, "%-8s n=%u", phase_names[i], hist->count);
+        if (hist->count)
+        {
+            g_string_append_printf (str, " mean=%" G_GINT64_FORMAT "ms max=%" G_GINT64_FORMAT "ms",
+                hist->total_us / hist->count / 1000, hist->max_us / 1000);
+            for (b = 0; b < N_HIST_BUCKETS; b++)
+            {
+                if (!hist->buckets[b]) continue;
+                if (b == N_HIST_BUCKETS - 1) g_string_append_printf (str, " >=%ums:%u", 1U << (b - 1), hist->buckets[b]);
+                else g_string_append_printf (str, " <%ums:%u", 1U << b, hist->buckets[b]);
+            }
+        }
+        g_string_append_c (str, '\n');
+    }
+    g_string_append_printf (str, "callbacks=%u total=%" G_GINT64_FORMAT "ms stalls=%u worst=%s (%" G_GINT64_FORMAT "ms)\n",
+        be->n_callbacks, be->callback_us / 1000, be->n_stalls, be->stall_worst ? be->stall_worst : "none", be->stall_max_us / 1000);
+
+    backend_resources (&rss_kb, &n_fds, &n_threads);
+    g_string_append_printf (str, "checks=%u errors=%u rss=%ldkB fds=%d threads=%d\n", be->n_checks, be->n_check_errors, rss_kb, n_fds, n_threads);
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
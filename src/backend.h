@@ -0,0 +1,133 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#ifndef UPDATER_BACKEND_H
+#define UPDATER_BACKEND_H
+
+#include <glib.h>
+
+#include "replay.h"
+#include "updates.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+typedef enum
+{
+    UPD_STATE_UNKNOWN,              /* No check has completed yet */
+    UPD_STATE_CHECKING,             /* Check in progress */
+    UPD_STATE_UP_TO_DATE,           /* Last check found no updates */
+    UPD_STATE_UPDATES,              /* Last check found updates */
+    UPD_STATE_ERROR                 /* Last check failed */
+} UpdaterState;
+
+typedef enum
+{
+    UPD_CLASS_SECURITY,             /* Security fixes */
+    UPD_CLASS_OTHER,                /* Everything else */
+    UPD_N_CLASSES
+} UpdaterClass;
+
+typedef enum
+{
+    PHASE_SPAWN,                    /* Starting and ending the check thread or helper */
+    PHASE_REFRESH,                  /* Refreshing the package cache */
+    PHASE_QUERY,                    /* Getting the list of updates */
+    PHASE_FILTER,                   /* Filtering and classifying updates */
+    PHASE_UI,                       /* Updating the icon and notifying */
+    N_PHASES
+} UpdaterPhase;
+
+/* Phase durations are counted in power-of-two millisecond buckets, from under 1ms up to 32s and over */
+#define N_HIST_BUCKETS 17
+
+typedef struct
+{
+    guint count;                    /* Number of samples */
+    gint64 total_us;                /* Sum of all samples */
+    gint64 max_us;                  /* Longest sample */
+    guint buckets[N_HIST_BUCKETS];  /* Number of samples in each bucket */
+} UpdaterHistogram;
+
+/* The backend holds the scheduler, the check pipeline and the current set */
+/* of updates, with no GTK dependency. Whatever shows the result - the     */
+/* panel plugins, or a test - is told of changes through these, all called */
+/* on the main thread                                                      */
+typedef struct
+{
+    void (*changed) (gpointer user_data);                       /* State or set of updates has changed */
+    void (*notify) (gboolean security, gpointer user_data);     /* Updates not yet notified should be announced */
+    void (*notify_clear) (gpointer user_data);                  /* No updates are pending - withdraw any announcement */
+} BackendFuncs;
+
+typedef struct _Backend Backend;
+
+typedef struct
+{
+    Backend *be;
+    const char *name;
+    gint64 start;
+} BackendWatch;
+
+/* Times the enclosing main thread callback, however it returns, as part of */
+/* main loop stall detection - only the outermost of nested ones is counted */
+#define WATCH(be) BackendWatch watch __attribute__ ((cleanup (backend_watch_end))) = backend_watch_begin (be, __func__)
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+extern Backend *backend_new (const BackendFuncs *funcs, gpointer user_data);
+extern void backend_free (Backend *be);
+extern void backend_set_interval (Backend *be, int hours);
+extern void backend_set_isolate (Backend *be, gboolean isolate);
+extern void backend_set_prom_file (Backend *be, const char *path);
+extern void backend_set_replay (Backend *be, Replay *rep, double speed);
+extern void backend_check (Backend *be, gboolean refresh);
+extern void backend_cancel (Backend *be);
+extern void backend_record (Backend *be, const char *path);
+extern void backend_install (Backend *be, UpdateSet *set);
+extern UpdaterState backend_get_state (Backend *be);
+extern const UpdateSet *backend_get_updates (Backend *be);
+extern UpdateSet *backend_ref_updates (Backend *be);
+extern gboolean backend_result_visible (Backend *be);
+extern gboolean backend_checking (Backend *be);
+extern gboolean backend_installing (Backend *be);
+extern void backend_get_counts (Backend *be, guint *n_checks, guint *n_errors);
+extern const UpdaterHistogram *backend_get_histogram (Backend *be, UpdaterPhase phase);
+extern void backend_status (Backend *be, GString *str);
+extern void backend_json (Backend *be, GString *str);
+extern void backend_stats (Backend *be, GString *str);
+extern void backend_resources (long *rss_kb, int *n_fds, int *n_threads);
+extern BackendWatch backend_watch_begin (Backend *be, const char *name);
+extern void backend_watch_end (BackendWatch *watch);
+
+#endif
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,369 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <glib-unix.h>
+
+#include "check.h"
+#include "log.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* "raspi-config nonint is_pi" tests the dpkg architecture, which is the one the plugin is built for */
+#if defined (__arm__) || defined (__aarch64__)
+#define IS_PI TRUE
+#else
+#define IS_PI FALSE
+#endif
+
+/* ThreadSanitizer cannot see the locks inside GLib, so the hand-over of a */
+/* check from its thread to the main loop, through an idle source, is       */
+/* marked for it - otherwise every result would be reported as a race      */
+#if defined (__SANITIZE_THREAD__)
+extern void __tsan_acquire (void *addr);
+extern void __tsan_release (void *addr);
+#define TSAN_ACQUIRE(addr) __tsan_acquire (addr)
+#define TSAN_RELEASE(addr) __tsan_release (addr)
+#else
+#define TSAN_ACQUIRE(addr)
+#define TSAN_RELEASE(addr)
+#endif
+
+/* An asynchronous check runs check_run, or replays a recorded check, on its */
+/* own thread, or runs the helper process. The thread only sees this, and   */
+/* the result is passed back to the main thread - if the caller detaches    */
+/* first, func is cleared, and the check just frees itself when it ends     */
+struct _Check
+{
+    GCancellable *cancellable;      /* Cancels this check only */
+    gboolean refresh;               /* Whether the cache is refreshed before the query */
+    Replay *replay;                 /* Recorded check to replay instead of using PackageKit, or NULL */
+    double speed;                   /* Speed-up factor for a replayed check */
+    Replay *result;                 /* Result, set by the check thread or parsed from the helper */
+    CheckDoneFunc func;             /* Called when the check ends, or NULL once detached */
+    gpointer user_data;
+    GPid pid;                       /* Helper process, if the check is isolated */
+    GString *out;                   /* Output read from the helper */
+    gboolean eof;                   /* Set once the helper output is closed */
+    gboolean exited;                /* Set once the helper has exited */
+    gint status;                    /* Wait status of the helper */
+};
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Number of checks which have not yet ended, including detached ones */
+static gint n_checks;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static gboolean filter_fn (PkPackage *package);
+static gpointer check_thread (gpointer data);
+static gboolean check_finished (gpointer data);
+static void check_end (Check *check);
+static gboolean spawn_helper (Check *check);
+static gboolean helper_output (gint fd, GIOCondition cond, gpointer data);
+static void helper_exited (GPid pid, gint status, gpointer data);
+static void helper_finish (Check *check);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+static gboolean filter_fn (PkPackage *package)
+{
+    PkInfoEnum info = pk_package_get_info (package);
+	switch (info)
+    {
+        case PK_INFO_ENUM_LOW:
+        case PK_INFO_ENUM_NORMAL:
+        case PK_INFO_ENUM_IMPORTANT:
+        case PK_INFO_ENUM_SECURITY:
+        case PK_INFO_ENUM_BUGFIX:
+        case PK_INFO_ENUM_ENHANCEMENT:
+        case PK_INFO_ENUM_BLOCKED:      return TRUE;
+                                        break;
+
+        default:                        return FALSE;
+                                        break;
+    }
+}
+
+/* Equivalent to checking "hostname -I" for an IPv4 address, without forking */
+gboolean check_net_available (void)
+{
+    struct ifaddrs *ifaddr, *ifa;
+    gboolean found = FALSE;
+
+    if (getifaddrs (&ifaddr)) return FALSE;
+    for (ifa = ifaddr; ifa && !found; ifa = ifa->ifa_next)
+    {
+        if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != AF_INET) continue;
+        if (!(ifa->ifa_flags & IFF_UP) || (ifa->ifa_flags & IFF_LOOPBACK)) continue;
+        found = TRUE;
+    }
+    freeifaddrs (ifaddr);
+    return found;
+}
+
+/* Equivalent to "ps ax | grep piwiz", without spawning a pipeline at startup */
+gboolean check_wizard_running (void)
+{
+    GDir *dir;
+    const char *name;
+    char *path, *comm;
+    gboolean found = FALSE;
+
+    dir = g_dir_open ("/proc", 0, NULL);
+    if (!dir) return FALSE;
+    while (!found && (name = g_dir_read_name (dir)))
+    {
+        if (!g_ascii_isdigit (*name)) continue;
+        path = g_build_filename ("/proc", name, "comm", NULL);
+        if (g_file_get_contents (path, &comm, NULL, NULL))
+        {
+            found = !strcmp (g_strchomp (comm), "piwiz");
+            g_free (comm);
+        }
+        g_free (path);
+    }
+    g_dir_close (dir);
+    return found;
+}
+
+/* Package filter for pk_package_sack_filter - on x86, amd64 packages are ignored */
+gboolean check_filter (PkPackage *package, gpointer)
+{
+    if (!IS_PI && strstr (pk_package_get_arch (package), "amd64")) return FALSE;
+    return filter_fn (package);
+}
+
+/* Package filter which passes only security updates */
+gboolean check_filter_security (PkPackage *package, gpointer user_data)
+{
+    return check_filter (package, user_data) && check_is_security (package);
+}
+
+gboolean check_is_security (PkPackage *package)
+{
+    return pk_package_get_info (package) == PK_INFO_ENUM_SECURITY;
+}
+
+/* Synchronous check for updates, for use outside the panel - the result has */
+/* the timing and outcome of each call, and the unfiltered list of updates   */
+Replay *check_run (gboolean refresh, GCancellable *cancellable)
+{
+    Replay *rep = replay_new ();
+    PkTask *task = pk_task_new ();
+    PkResults *results;
+    GError *error = NULL;
+    gint64 start;
+
+    if (refresh)
+    {
+        start = g_get_monotonic_time ();
+        results = pk_client_refresh_cache (PK_CLIENT (task), TRUE, cancellable, NULL, NULL, &error);
+        rep->refresh_us = g_get_monotonic_time () - start;
+        if (results) g_object_unref (results);
+        if (error)
+        {
+            rep->refresh_error = error->code;
+            g_error_free (error);
+            g_object_unref (task);
+            return rep;
+        }
+    }
+    else rep->refresh_error = REPLAY_OK;
+
+    start = g_get_monotonic_time ();
+    results = pk_client_get_updates (PK_CLIENT (task), PK_FILTER_ENUM_NONE, cancellable, NULL, NULL, &error);
+    rep->query_us = g_get_monotonic_time () - start;
+    if (error)
+    {
+        rep->query_error = error->code;
+        g_error_free (error);
+        g_object_unref (task);
+        return rep;
+    }
+
+    g_object_unref (rep->sack);
+    rep->sack = pk_results_get_package_sack (results);
+    g_object_unref (results);
+    g_object_unref (task);
+    return rep;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Asynchronous checks                                                        */
+/*----------------------------------------------------------------------------*/
+
+static gpointer check_thread (gpointer data)
+{
+    Check *check = (Check *) data;
+
+    if (check->replay) check->result = replay_run (check->replay, check->refresh, check->speed, check->cancellable);
+    else check->result = check_run (check->refresh, check->cancellable);
+    TSAN_RELEASE (check);
+    g_idle_add (check_finished, check);
+    return NULL;
+}
+
+static gboolean check_finished (gpointer data)
+{
+    TSAN_ACQUIRE (data);
+    check_end ((Check *) data);
+    return G_SOURCE_REMOVE;
+}
+
+static void check_end (Check *check)
+{
+    if (check->func) check->func (check->result, g_cancellable_is_cancelled (check->cancellable), check->user_data);
+    replay_free (check->result);
+    replay_free (check->replay);
+    if (check->out) g_string_free (check->out, TRUE);
+    g_object_unref (check->cancellable);
+    g_free (check);
+    g_atomic_int_add (&n_checks, -1);
+}
+
+/* When isolated, the check runs in a helper process which writes its result */
+/* in trace format and exits - PackageKit memory never enters the caller,   */
+/* and a crash in the check cannot take the caller down                     */
+static gboolean spawn_helper (Check *check)
+{
+    char *argv[3] = {HELPER_PATH, check->refresh ? NULL : "--no-refresh", NULL};
+    GError *error = NULL;
+    gint out_fd;
+
+    if (!g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, &check->pid, NULL, &out_fd, NULL, &error))
+    {
+        WARN ("Unable to run check helper - %s", error->message);
+        g_error_free (error);
+        check->pid = 0;
+        return FALSE;
+    }
+
+    check->out = g_string_new (NULL);
+    g_unix_fd_add (out_fd, G_IO_IN | G_IO_HUP | G_IO_ERR, helper_output, check);
+    g_child_watch_add (check->pid, helper_exited, check);
+    return TRUE;
+}
+
+static gboolean helper_output (gint fd, GIOCondition cond, gpointer data)
+{
+    Check *check = (Check *) data;
+    char buf[4096];
+    gssize len;
+
+    len = read (fd, buf, sizeof (buf));
+    if (len > 0)
+    {
+        g_string_append_len (check->out, buf, len);
+        return G_SOURCE_CONTINUE;
+    }
+    if (len < 0 && (errno == EINTR || errno == EAGAIN)) return G_SOURCE_CONTINUE;
+
+    close (fd);
+    check->eof = TRUE;
+    helper_finish (check);
+    return G_SOURCE_REMOVE;
+}
+
+static void helper_exited (GPid pid, gint status, gpointer data)
+{
+    Check *check = (Check *) data;
+
+    g_spawn_close_pid (pid);
+    check->pid = 0;
+    check->status = status;
+    check->exited = TRUE;
+    helper_finish (check);
+}
+
+/* Called once the helper has both exited and closed its output */
+static void helper_finish (Check *check)
+{
+    if (!check->eof || !check->exited) return;
+    if (g_spawn_check_wait_status (check->status, NULL)) check->result = replay_parse (check->out->str);
+    check_end (check);
+}
+
+/* Start a check for updates - the result is passed to func on the main */
+/* thread. A replay is used in place of PackageKit if one is given, and */
+/* otherwise the check runs in the helper process if isolate is set and  */
+/* the helper can be started                                            */
+Check *check_start (gboolean refresh, gboolean isolate, const Replay *replay, double speed, CheckDoneFunc func, gpointer user_data)
+{
+    Check *check = g_new0 (Check, 1);
+
+    g_atomic_int_inc (&n_checks);
+    check->cancellable = g_cancellable_new ();
+    check->refresh = refresh;
+    check->replay = replay ? replay_copy (replay) : NULL;
+    check->speed = speed;
+    check->func = func;
+    check->user_data = user_data;
+
+    if (!replay && isolate && spawn_helper (check)) return check;
+    g_thread_unref (g_thread_new (NULL, check_thread, check));
+    return check;
+}
+
+/* A cancelled check still ends through func, with cancelled set */
+void check_cancel (Check *check)
+{
+    g_cancellable_cancel (check->cancellable);
+    if (check->pid) kill (check->pid, SIGTERM);
+}
+
+/* Cancel the check, and never call func for it */
+void check_detach (Check *check)
+{
+    check->func = NULL;
+    check_cancel (check);
+}
+
+guint check_count (void)
+{
+    return g_atomic_int_get (&n_checks);
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,62 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#ifndef UPDATER_CHECK_H
+#define UPDATER_CHECK_H
+
+#include "replay.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Called on the main thread when an asynchronous check ends - rep is the */
+/* unfiltered result, or NULL if the check could not be run, and is freed */
+/* once the function returns                                               */
+typedef void (*CheckDoneFunc) (Replay *rep, gboolean cancelled, gpointer user_data);
+
+typedef struct _Check Check;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+extern gboolean check_net_available (void);
+extern gboolean check_wizard_running (void);
+extern gboolean check_filter (PkPackage *package, gpointer user_data);
+extern gboolean check_filter_security (PkPackage *package, gpointer user_data);
+extern gboolean check_is_security (PkPackage *package);
+extern Replay *check_run (gboolean refresh, GCancellable *cancellable);
+extern Check *check_start (gboolean refresh, gboolean isolate, const Replay *replay, double speed, CheckDoneFunc func, gpointer user_data);
+extern void check_cancel (Check *check);
+extern void check_detach (Check *check);
+extern guint check_count (void);
+
+#endif
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
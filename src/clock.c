@@ -0,0 +1,184 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <glib.h>
+
+#include "clock.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+typedef struct
+{
+    guint id;
+    gint64 due;                     /* Simulated monotonic time at which the timer fires */
+    gint64 interval;                /* Period of the timer in microseconds */
+    GSourceFunc func;
+    gpointer data;
+    gboolean removed;               /* Set if the timer is removed from inside its own callback */
+} SimTimer;
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* In simulation, timers are kept in a list sorted by due time and are only */
+/* fired by clock_advance - nothing is added to the GLib main loop           */
+static gboolean simulated;
+static gint64 sim_mono;
+static gint64 sim_real_base;
+static GList *sim_timers;
+static SimTimer *sim_current;
+static guint sim_next_id = 1;
+static guint sim_wakeups;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static gint compare_due (gconstpointer a, gconstpointer b);
+static guint sim_add (gint64 interval, GSourceFunc func, gpointer data);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+static gint compare_due (gconstpointer a, gconstpointer b)
+{
+    const SimTimer *ta = a, *tb = b;
+    return ta->due < tb->due ? -1 : ta->due > tb->due ? 1 : 0;
+}
+
+static guint sim_add (gint64 interval, GSourceFunc func, gpointer data)
+{
+    SimTimer *timer = g_new0 (SimTimer, 1);
+
+    timer->id = sim_next_id++;
+    timer->interval = interval;
+    timer->due = sim_mono + interval;
+    timer->func = func;
+    timer->data = data;
+    sim_timers = g_list_insert_sorted (sim_timers, timer, compare_due);
+    return timer->id;
+}
+
+gint64 clock_monotonic (void)
+{
+    return simulated ? sim_mono : g_get_monotonic_time ();
+}
+
+gint64 clock_real (void)
+{
+    return simulated ? sim_real_base + sim_mono : g_get_real_time ();
+}
+
+guint clock_timeout_add (guint ms, GSourceFunc func, gpointer data)
+{
+    if (!simulated) return g_timeout_add (ms, func, data);
+    return sim_add (ms * (gint64) 1000, func, data);
+}
+
+guint clock_timeout_add_seconds (guint secs, GSourceFunc func, gpointer data)
+{
+    if (!simulated) return g_timeout_add_seconds (secs, func, data);
+    return sim_add (secs * (gint64) G_USEC_PER_SEC, func, data);
+}
+
+guint clock_idle_add (GSourceFunc func, gpointer data)
+{
+    if (!simulated) return g_idle_add (func, data);
+    return sim_add (0, func, data);
+}
+
+gboolean clock_source_remove (guint id)
+{
+    GList *l;
+
+    if (!simulated) return g_source_remove (id);
+
+    if (sim_current && sim_current->id == id)
+    {
+        sim_current->removed = TRUE;
+        return TRUE;
+    }
+
+    for (l = sim_timers; l; l = l->next)
+    {
+        if (((SimTimer *) l->data)->id == id)
+        {
+            g_free (l->data);
+            sim_timers = g_list_delete_link (sim_timers, l);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* Switch to a simulated clock starting at the given wall clock time - this */
+/* must be done before any timers are added                                  */
+void clock_simulate (gint64 real_start)
+{
+    simulated = TRUE;
+    sim_mono = 0;
+    sim_real_base = real_start;
+    sim_wakeups = 0;
+}
+
+/* Run simulated time forward, firing every timer which falls due in order */
+void clock_advance (gint64 us)
+{
+    gint64 target = sim_mono + us;
+    SimTimer *timer;
+
+    while (sim_timers && ((SimTimer *) sim_timers->data)->due <= target)
+    {
+        timer = sim_timers->data;
+        sim_timers = g_list_delete_link (sim_timers, sim_timers);
+        if (timer->due > sim_mono) sim_mono = timer->due;
+        sim_wakeups++;
+
+        sim_current = timer;
+        if (timer->func (timer->data) && !timer->removed)
+        {
+            /* repeating idles are treated as due on the next microsecond */
+            timer->due = sim_mono + MAX (timer->interval, 1);
+            sim_timers = g_list_insert_sorted (sim_timers, timer, compare_due);
+        }
+        else g_free (timer);
+        sim_current = NULL;
+    }
+    sim_mono = target;
+}
+
+guint clock_wakeups (void)
+{
+    return sim_wakeups;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,241 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "history.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* When the file grows past the maximum, it is compacted to the newest records */
+#define HISTORY_MAX_RECORDS 4096
+#define HISTORY_KEEP_RECORDS 2048
+
+G_STATIC_ASSERT (sizeof (HistoryHeader) == 16);
+G_STATIC_ASSERT (sizeof (HistoryRecord) == 64);
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static char *history_path (const char *name);
+static int history_lock (int op);
+static void header_init (HistoryHeader *hdr);
+static gboolean header_valid (const HistoryHeader *hdr);
+static gboolean history_map (HistoryView *view, const char *path);
+static void history_compact (const char *path);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+static char *history_path (const char *name)
+{
+    char *dir, *path;
+
+    dir = g_build_filename (g_get_user_cache_dir (), "lxplug-updater", NULL);
+    g_mkdir_with_parents (dir, 0700);
+    path = g_build_filename (dir, name, NULL);
+    g_free (dir);
+    return path;
+}
+
+/* Every process with a panel or a tool appends to the same file, so appends */
+/* and compactions are serialised by a lock, which readers share while they */
+/* map the file. The lock is on a file of its own, because compaction        */
+/* replaces the history file - a lock on that would be on the old file, and */
+/* a writer waiting for it would then append to a file which had gone. The  */
+/* lock is released by closing the descriptor returned, which is -1 if it   */
+/* could not be taken                                                        */
+static int history_lock (int op)
+{
+    char *path;
+    int fd;
+
+    path = history_path ("history.lock");
+    fd = open (path, O_RDONLY | O_CREAT | O_CLOEXEC, 0600);
+    g_free (path);
+    if (fd < 0) return -1;
+
+    while (flock (fd, op) < 0)
+    {
+        if (errno == EINTR) continue;
+        close (fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void header_init (HistoryHeader *hdr)
+{
+    memset (hdr, 0, sizeof (HistoryHeader));
+    memcpy (hdr->magic, HISTORY_MAGIC, 4);
+    hdr->version = HISTORY_VERSION;
+    hdr->rec_size = sizeof (HistoryRecord);
+}
+
+static gboolean header_valid (const HistoryHeader *hdr)
+{
+    if (memcmp (hdr->magic, HISTORY_MAGIC, 4)) return FALSE;
+    if (hdr->version != HISTORY_VERSION) return FALSE;
+    if (hdr->rec_size != sizeof (HistoryRecord)) return FALSE;
+    return TRUE;
+}
+
+/* Map the file without taking the lock - for history_open, or a writer */
+/* which already holds it                                                */
+static gboolean history_map (HistoryView *view, const char *path)
+{
+    const HistoryHeader *hdr;
+    gsize len;
+
+    memset (view, 0, sizeof (HistoryView));
+
+    view->map = g_mapped_file_new (path, FALSE, NULL);
+    if (!view->map) return FALSE;
+
+    len = g_mapped_file_get_length (view->map);
+    hdr = (const HistoryHeader *) g_mapped_file_get_contents (view->map);
+    if (len < sizeof (HistoryHeader) || !header_valid (hdr))
+    {
+        history_close (view);
+        return FALSE;
+    }
+
+    view->records = (const HistoryRecord *) (hdr + 1);
+    view->n_records = (len - sizeof (HistoryHeader)) / sizeof (HistoryRecord);
+    return TRUE;
+}
+
+/* Rewrite the file with only the newest records, with the lock held - the */
+/* rename is atomic, so a reader with the old file mapped is unaffected     */
+static void history_compact (const char *path)
+{
+    HistoryView view;
+    HistoryHeader hdr;
+    GByteArray *buf;
+    int first;
+
+    if (!history_map (&view, path)) return;
+
+    first = view.n_records > HISTORY_KEEP_RECORDS ? view.n_records - HISTORY_KEEP_RECORDS : 0;
+    header_init (&hdr);
+    buf = g_byte_array_sized_new (sizeof (HistoryHeader) + (view.n_records - first) * sizeof (HistoryRecord));
+    g_byte_array_append (buf, (const guint8 *) &hdr, sizeof (HistoryHeader));
+    g_byte_array_append (buf, (const guint8 *) (view.records + first), (view.n_records - first) * sizeof (HistoryRecord));
+    history_close (&view);
+
+    g_file_set_contents_full (path, (const char *) buf->data, buf->len, G_FILE_SET_CONTENTS_CONSISTENT, 0600, NULL);
+    g_byte_array_unref (buf);
+}
+
+void history_append (const HistoryRecord *rec)
+{
+    HistoryHeader hdr;
+    struct stat st;
+    off_t size, torn;
+    char *path;
+    int fd, lock;
+
+    /* the file is only opened once the lock is held, so that it is not one */
+    /* which a compaction has just replaced                                 */
+    lock = history_lock (LOCK_EX);
+    path = history_path ("history");
+    fd = open (path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        g_free (path);
+        if (lock >= 0) close (lock);
+        return;
+    }
+
+    /* start again if the file is empty, unreadable or from another version - */
+    /* it is replaced rather than truncated, as a reader may have it mapped    */
+    size = fstat (fd, &st) == 0 ? st.st_size : 0;
+    if (size < (off_t) sizeof (HistoryHeader) || pread (fd, &hdr, sizeof (HistoryHeader), 0) != sizeof (HistoryHeader) || !header_valid (&hdr))
+    {
+        close (fd);
+        header_init (&hdr);
+        if (g_file_set_contents_full (path, (const char *) &hdr, sizeof (HistoryHeader), G_FILE_SET_CONTENTS_CONSISTENT, 0600, NULL))
+            fd = open (path, O_WRONLY | O_APPEND | O_CLOEXEC);
+        else fd = -1;
+        size = fd < 0 ? 0 : sizeof (HistoryHeader);
+    }
+
+    if (size)
+    {
+        /* drop any partial record left by a writer which was killed - only past */
+        /* the last whole record, which is as far as any reader has mapped       */
+        torn = (size - sizeof (HistoryHeader)) % sizeof (HistoryRecord);
+        if (torn && ftruncate (fd, size - torn) == 0) size -= torn;
+
+        if (write (fd, rec, sizeof (HistoryRecord)) == sizeof (HistoryRecord)) size += sizeof (HistoryRecord);
+    }
+    if (fd >= 0) close (fd);
+
+    if (size && (size - sizeof (HistoryHeader)) / sizeof (HistoryRecord) > HISTORY_MAX_RECORDS)
+        history_compact (path);
+    g_free (path);
+    if (lock >= 0) close (lock);
+}
+
+/* The lock is only held while the file is mapped - later appends go past */
+/* the records counted, and a compaction replaces the file                 */
+gboolean history_open (HistoryView *view)
+{
+    gboolean res;
+    char *path;
+    int lock;
+
+    lock = history_lock (LOCK_SH);
+    path = history_path ("history");
+    res = history_map (view, path);
+    g_free (path);
+    if (lock >= 0) close (lock);
+    return res;
+}
+
+void history_close (HistoryView *view)
+{
+    if (view->map) g_mapped_file_unref (view->map);
+    view->map = NULL;
+    view->records = NULL;
+    view->n_records = 0;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,92 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#ifndef UPDATER_HISTORY_H
+#define UPDATER_HISTORY_H
+
+#include <glib.h>
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* The history file is a fixed header followed by fixed-size records in host */
+/* byte order, so that it can be mapped and read as an array of records      */
+
+#define HISTORY_MAGIC "UPDH"
+#define HISTORY_VERSION 1
+
+#define HISTORY_MAX_PHASES 6
+
+typedef enum
+{
+    HISTORY_CHECK = 1,              /* Check for updates */
+    HISTORY_INSTALL = 2             /* Run of the installer */
+} HistoryType;
+
+typedef struct
+{
+    char magic[4];
+    guint16 version;
+    guint16 rec_size;
+    guint32 reserved[2];
+} HistoryHeader;
+
+typedef struct
+{
+    guint8 type;                    /* HistoryType */
+    guint8 error;                   /* Non-zero if the check or install failed */
+    guint16 n_updates;              /* Number of pending updates */
+    guint16 n_security;             /* Number of pending security updates */
+    guint16 reserved1;
+    gint64 start;                   /* Wall clock start time in microseconds */
+    gint64 end;                     /* Wall clock end time in microseconds */
+    guint64 fingerprint;            /* Fingerprint of the set of pending updates */
+    guint32 phase_ms[HISTORY_MAX_PHASES];   /* Duration of each phase of a check in milliseconds */
+    gint32 status;                  /* Error code or installer exit status */
+    guint32 reserved2;
+} HistoryRecord;
+
+typedef struct
+{
+    GMappedFile *map;
+    const HistoryRecord *records;
+    int n_records;
+} HistoryView;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+extern void history_append (const HistoryRecord *rec);
+extern gboolean history_open (HistoryView *view);
+extern void history_close (HistoryView *view);
+
+#endif
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,198 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "log.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Must be a power of two */
+#define LOG_RING_SIZE 256
+
+#define LOG_MSG_LEN 116
+
+typedef struct
+{
+    gint seq;                       /* Index of the event plus one, set once the entry is complete */
+    gint level;                     /* LogLevel of the event */
+    gint64 time;                    /* Wall clock time of the event in microseconds */
+    char msg[LOG_MSG_LEN];
+} LogEntry;
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Writers claim a slot by atomically incrementing the head, so events can be */
+/* logged from any thread without taking a lock. Each slot is a seqlock - the */
+/* writer clears seq, stores the fields and then sets seq, and a dump keeps   */
+/* its copy only if seq was set to the same event before and after copying.   */
+/* Every field is stored and loaded atomically, so a dump which races a       */
+/* writer gets a torn copy, which it drops, rather than a data race           */
+static LogEntry ring[LOG_RING_SIZE];
+static gint ring_head;
+
+static gint log_level = LOG_LEVEL_INFO;
+static gint log_journal;
+
+static const char *level_names[] = { "error", "warning", "info", "debug" };
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static gboolean entry_copy (gint index, LogEntry *copy);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+void log_init (void)
+{
+    const char *env;
+
+    env = g_getenv ("UPDATER_LOG_LEVEL");
+    if (env) log_set_level (env);
+
+    env = g_getenv ("UPDATER_LOG_JOURNAL");
+    if (env) log_set_journal (atoi (env) != 0);
+}
+
+void log_event (LogLevel level, const char *fmt, ...)
+{
+    LogEntry *entry;
+    char msg[LOG_MSG_LEN];
+    va_list args;
+    gint index, i;
+
+    if ((gint) level > g_atomic_int_get (&log_level)) return;
+
+    va_start (args, fmt);
+    g_vsnprintf (msg, LOG_MSG_LEN, fmt, args);
+    va_end (args);
+
+    index = g_atomic_int_add (&ring_head, 1);
+    entry = &ring[index & (LOG_RING_SIZE - 1)];
+
+    __atomic_store_n (&entry->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+    __atomic_store_n (&entry->level, level, __ATOMIC_RELAXED);
+    __atomic_store_n (&entry->time, g_get_real_time (), __ATOMIC_RELAXED);
+    for (i = 0; i < LOG_MSG_LEN; i++)
+    {
+        __atomic_store_n (&entry->msg[i], msg[i], __ATOMIC_RELAXED);
+        if (!msg[i]) break;
+    }
+    __atomic_store_n (&entry->seq, index + 1, __ATOMIC_RELEASE);
+
+    if (g_atomic_int_get (&log_journal))
+    {
+        if (level == LOG_LEVEL_ERROR) g_warning ("up: %s", msg);
+        else g_message ("up: %s", msg);
+    }
+
+    if (level == LOG_LEVEL_ERROR) log_dump ();
+}
+
+gboolean log_set_level (const char *name)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (level_names); i++)
+    {
+        if (!g_ascii_strcasecmp (name, level_names[i]))
+        {
+            g_atomic_int_set (&log_level, i);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void log_set_journal (gboolean enable)
+{
+    g_atomic_int_set (&log_journal, enable);
+}
+
+/* Copy an event out of the ring - FALSE if its slot is being written, or */
+/* has been reused for a later event                                      */
+static gboolean entry_copy (gint index, LogEntry *copy)
+{
+    LogEntry *entry = &ring[index & (LOG_RING_SIZE - 1)];
+    int i;
+
+    if (__atomic_load_n (&entry->seq, __ATOMIC_ACQUIRE) != index + 1) return FALSE;
+    copy->level = __atomic_load_n (&entry->level, __ATOMIC_RELAXED);
+    copy->time = __atomic_load_n (&entry->time, __ATOMIC_RELAXED);
+    for (i = 0; i < LOG_MSG_LEN - 1; i++)
+        if (!(copy->msg[i] = __atomic_load_n (&entry->msg[i], __ATOMIC_RELAXED))) break;
+    copy->msg[i] = 0;
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+    return __atomic_load_n (&entry->seq, __ATOMIC_RELAXED) == index + 1;
+}
+
+/* Write the contents of the ring to a file in the runtime directory, which */
+/* is on tmpfs, so that dumps do not wear the SD card                        */
+void log_dump (void)
+{
+    LogEntry copy;
+    GDateTime *dt;
+    GString *str;
+    char *path, *ts;
+    gint head, index, level;
+
+    str = g_string_new (NULL);
+    head = g_atomic_int_get (&ring_head);
+    for (index = head > LOG_RING_SIZE ? head - LOG_RING_SIZE : 0; index < head; index++)
+    {
+        /* skip entries which are being written or were overwritten while copying */
+        if (!entry_copy (index, &copy)) continue;
+        level = CLAMP (copy.level, LOG_LEVEL_ERROR, LOG_LEVEL_DEBUG);
+
+        dt = g_date_time_new_from_unix_local (copy.time / G_USEC_PER_SEC);
+        ts = g_date_time_format (dt, "%F %T");
+        g_string_append_printf (str, "%s.%03d %-7s %s\n", ts, (int) (copy.time % G_USEC_PER_SEC) / 1000,
+            level_names[level], copy.msg);
+        g_free (ts);
+        g_date_time_unref (dt);
+    }
+
+    path = g_build_filename (g_get_user_runtime_dir (), "lxplug-updater.log", NULL);
+    g_file_set_contents (path, str->str, str->len, NULL);
+    g_free (path);
+    g_string_free (str, TRUE);
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,234 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "log.h"
+#include "replay.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Traces are plain text, one item per line:                           */
+/*   # updater trace 2                                                  */
+/*   refresh <microseconds> <error code, or -1 for success>             */
+/*   query <microseconds> <error code, or -1 for success>               */
+/*   package <info> <package id>                                        */
+
+#define REPLAY_HEADER "# updater trace 2"
+
+/* Version 1 traces used 0 for success - as PackageKit error code 0 is also */
+/* a failure, failed calls in those traces cannot be told apart from good  */
+/* ones, so 0 is read as success as it was written                          */
+#define REPLAY_HEADER_V1 "# updater trace 1"
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static gboolean replay_wait (gint64 us, double speed, GCancellable *cancellable);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+/* Wait for a recorded delay divided by the speed - FALSE if cancelled */
+static gboolean replay_wait (gint64 us, double speed, GCancellable *cancellable)
+{
+    GPollFD pfd;
+
+    if (speed > 0 && us > 0)
+    {
+        if (cancellable && g_cancellable_make_pollfd (cancellable, &pfd))
+        {
+            pfd.events = G_IO_IN;
+            g_poll (&pfd, 1, (gint) (us / 1000 / speed));
+            g_cancellable_release_fd (cancellable);
+        }
+        else g_usleep ((gulong) (us / speed));
+    }
+    return !g_cancellable_is_cancelled (cancellable);
+}
+
+GString *replay_format (const Replay *rep)
+{
+    GPtrArray *pkgs;
+    GString *str;
+    PkPackage *pkg;
+    guint i;
+
+    str = g_string_new (REPLAY_HEADER "\n");
+    g_string_append_printf (str, "refresh %" G_GINT64_FORMAT " %d\n", rep->refresh_us, rep->refresh_error);
+    g_string_append_printf (str, "query %" G_GINT64_FORMAT " %d\n", rep->query_us, rep->query_error);
+
+    if (rep->sack)
+    {
+        pkgs = pk_package_sack_get_array (rep->sack);
+        for (i = 0; i < pkgs->len; i++)
+        {
+            pkg = PK_PACKAGE (g_ptr_array_index (pkgs, i));
+            g_string_append_printf (str, "package %s %s\n", pk_info_enum_to_string (pk_package_get_info (pkg)), pk_package_get_id (pkg));
+        }
+        g_ptr_array_unref (pkgs);
+    }
+    return str;
+}
+
+Replay *replay_parse (const char *buf)
+{
+    Replay *rep;
+    PkPackage *pkg;
+    char **lines, **fields;
+    gboolean v1;
+    int i;
+
+    lines = g_strsplit (buf, "\n", -1);
+    v1 = lines[0] && !strcmp (lines[0], REPLAY_HEADER_V1);
+    if (!lines[0] || (strcmp (lines[0], REPLAY_HEADER) && !v1))
+    {
+        g_strfreev (lines);
+        return NULL;
+    }
+    if (v1) WARN ("Version 1 trace - failed calls with error code 0 are replayed as successful");
+
+    rep = replay_new ();
+    for (i = 1; lines[i]; i++)
+    {
+        fields = g_strsplit (lines[i], " ", 3);
+        if (g_strv_length (fields) == 3)
+        {
+            if (!strcmp (fields[0], "refresh"))
+            {
+                rep->refresh_us = g_ascii_strtoll (fields[1], NULL, 10);
+                rep->refresh_error = atoi (fields[2]);
+                if (v1 && !rep->refresh_error) rep->refresh_error = REPLAY_OK;
+            }
+            else if (!strcmp (fields[0], "query"))
+            {
+                rep->query_us = g_ascii_strtoll (fields[1], NULL, 10);
+                rep->query_error = atoi (fields[2]);
+                if (v1 && !rep->query_error) rep->query_error = REPLAY_OK;
+            }
+            else if (!strcmp (fields[0], "package"))
+            {
+                pkg = pk_package_new ();
+                if (pk_package_set_id (pkg, fields[2], NULL))
+                {
+                    pk_package_set_info (pkg, pk_info_enum_from_string (fields[1]));
+                    pk_package_sack_add_package (rep->sack, pkg);
+                }
+                g_object_unref (pkg);
+            }
+        }
+        g_strfreev (fields);
+    }
+    g_strfreev (lines);
+    return rep;
+}
+
+gboolean replay_save (const char *path, const Replay *rep)
+{
+    GString *str;
+    gboolean res;
+
+    str = replay_format (rep);
+    res = g_file_set_contents (path, str->str, str->len, NULL);
+    g_string_free (str, TRUE);
+    return res;
+}
+
+Replay *replay_load (const char *path)
+{
+    Replay *rep;
+    char *buf;
+
+    if (!g_file_get_contents (path, &buf, NULL, NULL)) return NULL;
+    rep = replay_parse (buf);
+    g_free (buf);
+    return rep;
+}
+
+Replay *replay_new (void)
+{
+    Replay *rep = g_new0 (Replay, 1);
+
+    rep->refresh_error = REPLAY_OK;
+    rep->query_error = REPLAY_OK;
+    rep->sack = pk_package_sack_new ();
+    return rep;
+}
+
+/* The copy shares the package sack, which is never changed once loaded */
+Replay *replay_copy (const Replay *rep)
+{
+    Replay *copy = g_new (Replay, 1);
+
+    *copy = *rep;
+    g_object_ref (copy->sack);
+    return copy;
+}
+
+/* Run a recorded check in place of check_run, on the calling thread - the   */
+/* recorded delays are divided by speed, and a speed of 0 replays them with */
+/* no delay. A cancelled call fails with G_IO_ERROR_CANCELLED, as it would   */
+/* from PackageKit.                                                         */
+Replay *replay_run (const Replay *rep, gboolean refresh, double speed, GCancellable *cancellable)
+{
+    Replay *res = replay_new ();
+    gint64 start;
+
+    if (refresh)
+    {
+        start = g_get_monotonic_time ();
+        res->refresh_error = replay_wait (rep->refresh_us, speed, cancellable) ? rep->refresh_error : G_IO_ERROR_CANCELLED;
+        res->refresh_us = g_get_monotonic_time () - start;
+        if (res->refresh_error != REPLAY_OK) return res;
+    }
+
+    start = g_get_monotonic_time ();
+    res->query_error = replay_wait (rep->query_us, speed, cancellable) ? rep->query_error : G_IO_ERROR_CANCELLED;
+    res->query_us = g_get_monotonic_time () - start;
+    if (res->query_error != REPLAY_OK) return res;
+
+    g_object_unref (res->sack);
+    res->sack = g_object_ref (rep->sack);
+    return res;
+}
+
+void replay_free (Replay *rep)
+{
+    if (!rep) return;
+    if (rep->sack) g_object_unref (rep->sack);
+    g_free (rep);
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,71 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#ifndef UPDATER_REPLAY_H
+#define UPDATER_REPLAY_H
+
+#include <glib.h>
+
+#define I_KNOW_THE_PACKAGEKIT_GLIB2_API_IS_SUBJECT_TO_CHANGE
+#include <packagekit-glib2/packagekit.h>
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Error code recorded for a call which succeeded */
+#define REPLAY_OK -1
+
+/* A recorded check - the timing and outcome of each PackageKit call, and */
+/* the unfiltered package list which was returned                          */
+
+typedef struct _Replay
+{
+    gint64 refresh_us;              /* Duration of the cache refresh */
+    int refresh_error;              /* PackageKit error code from the refresh, or REPLAY_OK */
+    gint64 query_us;                /* Duration of the update query */
+    int query_error;                /* PackageKit error code from the query, or REPLAY_OK */
+    PkPackageSack *sack;            /* Packages returned by the query */
+} Replay;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+extern Replay *replay_new (void);
+extern GString *replay_format (const Replay *rep);
+extern Replay *replay_parse (const char *buf);
+extern gboolean replay_save (const char *path, const Replay *rep);
+extern Replay *replay_load (const char *path);
+extern Replay *replay_copy (const Replay *rep);
+extern Replay *replay_run (const Replay *rep, gboolean refresh, double speed, GCancellable *cancellable);
+extern void replay_free (Replay *rep);
+
+#endif
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
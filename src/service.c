@@ -0,0 +1,222 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <string.h>
+
+#include <gio/gio.h>
+
+#include "log.h"
+#include "service.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Session bus service which publishes the result of the plugin's checks, so */
+/* that other applications can use it instead of running their own          */
+
+struct _Service
+{
+    guint owner_id;                 /* Bus name ownership ID */
+    guint reg_id;                   /* Object registration ID, or 0 if not exported */
+    GDBusConnection *conn;          /* Connection on which the object is exported */
+    ServiceCheckFunc check;         /* Starts a check in the plugin */
+    gpointer user_data;
+    char *state;                    /* Current values of the properties */
+    int n_updates;
+    int n_security;
+    gint64 last_check;
+    guint64 fingerprint;
+};
+
+static const char introspection[] =
+    "<node>"
+    "  <interface name='" SERVICE_INTERFACE "'>"
+    "    <method name='Check'>"
+    "      <arg type='b' name='refresh' direction='in'/>"
+    "    </method>"
+    "    <property type='s' name='State' access='read'/>"
+    "    <property type='i' name='Count' access='read'/>"
+    "    <property type='i' name='SecurityCount' access='read'/>"
+    "    <property type='x' name='LastCheck' access='read'/>"
+    "    <property type='t' name='Fingerprint' access='read'/>"
+    "  </interface>"
+    "</node>";
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+static GDBusNodeInfo *node_info;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static GVariant *get_value (Service *svc, const char *name);
+static void method_call (GDBusConnection *conn, const gchar *sender, const gchar *path, const gchar *iface,
+    const gchar *method, GVariant *params, GDBusMethodInvocation *invocation, gpointer user_data);
+static GVariant *get_property (GDBusConnection *conn, const gchar *sender, const gchar *path, const gchar *iface,
+    const gchar *name, GError **error, gpointer user_data);
+static void bus_acquired (GDBusConnection *conn, const gchar *name, gpointer user_data);
+static void name_lost (GDBusConnection *conn, const gchar *name, gpointer user_data);
+
+static const GDBusInterfaceVTable vtable = { method_call, get_property, NULL };
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+static GVariant *get_value (Service *svc, const char *name)
+{
+    if (!strcmp (name, "State")) return g_variant_new_string (svc->state);
+    if (!strcmp (name, "Count")) return g_variant_new_int32 (svc->n_updates);
+    if (!strcmp (name, "SecurityCount")) return g_variant_new_int32 (svc->n_security);
+    if (!strcmp (name, "LastCheck")) return g_variant_new_int64 (svc->last_check);
+    if (!strcmp (name, "Fingerprint")) return g_variant_new_uint64 (svc->fingerprint);
+    return NULL;
+}
+
+static void method_call (GDBusConnection *, const gchar *, const gchar *, const gchar *,
+    const gchar *method, GVariant *params, GDBusMethodInvocation *invocation, gpointer user_data)
+{
+    Service *svc = (Service *) user_data;
+    gboolean refresh;
+
+    if (!strcmp (method, "Check"))
+    {
+        /* the plugin coalesces this with any check already in progress */
+        g_variant_get (params, "(b)", &refresh);
+        DEBUG ("Check requested over D-Bus");
+        svc->check (refresh, svc->user_data);
+        g_dbus_method_invocation_return_value (invocation, NULL);
+    }
+    else g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD, "Unknown method %s", method);
+}
+
+static GVariant *get_property (GDBusConnection *, const gchar *, const gchar *, const gchar *,
+    const gchar *name, GError **error, gpointer user_data)
+{
+    GVariant *val = get_value ((Service *) user_data, name);
+
+    if (!val) g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property %s", name);
+    return val;
+}
+
+static void bus_acquired (GDBusConnection *conn, const gchar *, gpointer user_data)
+{
+    Service *svc = (Service *) user_data;
+    GError *error = NULL;
+
+    svc->reg_id = g_dbus_connection_register_object (conn, SERVICE_PATH, node_info->interfaces[0], &vtable, svc, NULL, &error);
+    if (!svc->reg_id)
+    {
+        WARN ("Unable to export D-Bus object - %s", error->message);
+        g_error_free (error);
+        return;
+    }
+    svc->conn = g_object_ref (conn);
+}
+
+/* Another panel may already own the name - this one then stays queued, and */
+/* takes over if that panel exits                                          */
+static void name_lost (GDBusConnection *, const gchar *name, gpointer)
+{
+    DEBUG ("D-Bus name %s is owned elsewhere", name);
+}
+
+Service *service_new (ServiceCheckFunc check, gpointer user_data)
+{
+    Service *svc;
+
+    if (!node_info) node_info = g_dbus_node_info_new_for_xml (introspection, NULL);
+
+    svc = g_new0 (Service, 1);
+    svc->check = check;
+    svc->user_data = user_data;
+    svc->state = g_strdup ("unknown");
+    svc->owner_id = g_bus_own_name (G_BUS_TYPE_SESSION, SERVICE_NAME, G_BUS_NAME_OWNER_FLAGS_NONE,
+        bus_acquired, NULL, name_lost, svc, NULL);
+    return svc;
+}
+
+/* Only the properties which have changed are signalled */
+void service_update (Service *svc, const char *state, const UpdateSet *set, gint64 last_check)
+{
+    GVariantBuilder changed;
+    const char *names[5];
+    int n = 0, i;
+
+    if (!svc) return;
+
+    if (strcmp (svc->state, state))
+    {
+        g_free (svc->state);
+        svc->state = g_strdup (state);
+        names[n++] = "State";
+    }
+    if (svc->n_updates != set->n_updates)
+    {
+        svc->n_updates = set->n_updates;
+        names[n++] = "Count";
+    }
+    if (svc->n_security != set->n_security)
+    {
+        svc->n_security = set->n_security;
+        names[n++] = "SecurityCount";
+    }
+    if (svc->last_check != last_check)
+    {
+        svc->last_check = last_check;
+        names[n++] = "LastCheck";
+    }
+    if (svc->fingerprint != set->fingerprint)
+    {
+        svc->fingerprint = set->fingerprint;
+        names[n++] = "Fingerprint";
+    }
+    if (!n || !svc->conn) return;
+
+    g_variant_builder_init (&changed, G_VARIANT_TYPE ("a{sv}"));
+    for (i = 0; i < n; i++)
+        g_variant_builder_add (&changed, "{sv}", names[i], get_value (svc, names[i]));
+    g_dbus_connection_emit_signal (svc->conn, NULL, SERVICE_PATH, "org.freedesktop.DBus.Properties", "PropertiesChanged",
+        g_variant_new ("(sa{sv}as)", SERVICE_INTERFACE, &changed, NULL), NULL);
+}
+
+void service_free (Service *svc)
+{
+    if (!svc) return;
+    if (svc->reg_id) g_dbus_connection_unregister_object (svc->conn, svc->reg_id);
+    if (svc->conn) g_object_unref (svc->conn);
+    g_bus_unown_name (svc->owner_id);
+    g_free (svc->state);
+    g_free (svc);
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,342 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <fcntl.h>
+#include <grp.h>
+#include <pwd.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+#include "clock.h"
+#include "log.h"
+#include "shared.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Every panel on the machine - of any user, in any session, and either     */
+/* panel - shares one result. A check is only run by the panel which holds  */
+/* the leader lock, and the others pick up the result it writes through a   */
+/* file monitor. The files are kept in SHARED_DIR, which systemd-tmpfiles   */
+/* creates at boot owned by root and setgid to a group every desktop user   */
+/* is in. As the result decides whether updates are shown, a result there  */
+/* is only used if it is in that group and was written by root or a member */
+/* of the group. If the directory is missing, or not set up like that, the  */
+/* files are kept in the user's private runtime directory instead, and only */
+/* that user's panels share them. UPDATER_SHARED_DIR overrides SHARED_DIR,  */
+/* and an empty value always uses the runtime directory. Every function     */
+/* accepts a NULL Shared, which acts as if no other panel is running.       */
+
+struct _Shared
+{
+    char *lock_path;
+    char *result_path;
+    gid_t gid;                      /* Group of the system-wide directory, or -1 if the runtime directory is used */
+    uid_t owner;                    /* Last owner of a result checked against the group */
+    gboolean owner_trusted;         /* Whether that owner is root or a member of the group */
+    int lock_fd;                    /* Leader lock file, or -1 */
+    gboolean leading;               /* Set while this panel holds the leader lock */
+    gint64 last_seen;               /* Write time of the newest result published or delivered */
+    GFileMonitor *monitor;          /* Watches for results written by other panels */
+    SharedResultFunc func;          /* Called with each new result from another panel */
+    gpointer user_data;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static char *shared_dir (gid_t *gid);
+static gboolean in_group (uid_t uid, gid_t gid);
+static gboolean trusted (Shared *sh, const struct stat *st);
+static SharedResult *result_load (Shared *sh);
+static void result_free (SharedResult *res);
+static void result_changed (GFileMonitor *monitor, GFile *file, GFile *other, GFileMonitorEvent event, gpointer user_data);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+/* The system-wide directory is only used if it is owned by root, cannot be */
+/* written by others, and this user can create files in it                  */
+static char *shared_dir (gid_t *gid)
+{
+    const char *dir = g_getenv ("UPDATER_SHARED_DIR");
+    char *path;
+    GStatBuf st;
+
+    if (!dir) dir = SHARED_DIR;
+    if (*dir && !g_stat (dir, &st) && S_ISDIR (st.st_mode) && st.st_uid == 0 && !(st.st_mode & S_IWOTH)
+        && !access (dir, W_OK | X_OK))
+    {
+        *gid = st.st_gid;
+        return g_strdup (dir);
+    }
+
+    *gid = (gid_t) -1;
+    path = g_build_filename (g_get_user_runtime_dir (), "lxplug-updater", NULL);
+    g_mkdir_with_parents (path, 0700);
+    return path;
+}
+
+static gboolean in_group (uid_t uid, gid_t gid)
+{
+    struct passwd *pw;
+    struct group *gr;
+    char **mem;
+
+    pw = getpwuid (uid);
+    if (!pw) return FALSE;
+    if (pw->pw_gid == gid) return TRUE;
+
+    gr = getgrgid (gid);
+    if (!gr) return FALSE;
+    for (mem = gr->gr_mem; *mem; mem++)
+        if (!strcmp (*mem, pw->pw_name)) return TRUE;
+    return FALSE;
+}
+
+/* This user's own files are always trusted. Others are only trusted in the */
+/* system-wide directory - the group lookup may go to a directory service,  */
+/* so the answer for the last owner seen is kept                            */
+static gboolean trusted (Shared *sh, const struct stat *st)
+{
+    if (!S_ISREG (st->st_mode)) return FALSE;
+    if (st->st_uid == getuid ()) return TRUE;
+    if (sh->gid == (gid_t) -1 || st->st_gid != sh->gid || (st->st_mode & S_IWOTH)) return FALSE;
+    if (st->st_uid == 0) return TRUE;
+
+    if (st->st_uid != sh->owner)
+    {
+        sh->owner = st->st_uid;
+        sh->owner_trusted = in_group (st->st_uid, sh->gid);
+        if (!sh->owner_trusted) WARN ("Ignoring shared result written by user %u, who is not in group %u", (guint) st->st_uid, (guint) sh->gid);
+    }
+    return sh->owner_trusted;
+}
+
+/* Map and validate the result file - every length is checked against the */
+/* mapping, as the file may be from an older or newer version of the panel. */
+/* The owner is checked on the open file, so that the file cannot be       */
+/* replaced between the check and the mapping                              */
+static SharedResult *result_load (Shared *sh)
+{
+    SharedResult *res;
+    GMappedFile *map;
+    const SharedHeader *hdr;
+    const char *ptr, *end, *nul;
+    struct stat st;
+    guint i;
+    int fd;
+
+    fd = open (sh->result_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    if (fstat (fd, &st) || !trusted (sh, &st))
+    {
+        close (fd);
+        return NULL;
+    }
+
+    /* the mapping stays valid once the file is closed */
+    map = g_mapped_file_new_from_fd (fd, FALSE, NULL);
+    close (fd);
+    if (!map) return NULL;
+
+    hdr = (const SharedHeader *) g_mapped_file_get_contents (map);
+    end = (const char *) hdr + g_mapped_file_get_length (map);
+    if (g_mapped_file_get_length (map) < sizeof (SharedHeader) || memcmp (hdr->magic, SHARED_MAGIC, 4)
+        || hdr->version != SHARED_VERSION || hdr->n_updates > (end - (const char *) (hdr + 1)) / 2)
+    {
+        g_mapped_file_unref (map);
+        return NULL;
+    }
+
+    res = g_new0 (SharedResult, 1);
+    res->map = map;
+    res->written = hdr->written;
+    res->pid = hdr->pid;
+    res->ids = g_new (const char *, hdr->n_updates + 1);
+    res->security = g_new (guint8, hdr->n_updates + 1);
+
+    ptr = (const char *) (hdr + 1);
+    for (i = 0; i < hdr->n_updates; i++)
+    {
+        if (ptr >= end || !(nul = memchr (ptr + 1, 0, end - ptr - 1)))
+        {
+            result_free (res);
+            return NULL;
+        }
+        res->security[i] = *ptr;
+        res->ids[i] = ptr + 1;
+        ptr = nul + 1;
+    }
+    res->ids[i] = NULL;
+    res->n_updates = hdr->n_updates;
+    return res;
+}
+
+static void result_free (SharedResult *res)
+{
+    g_mapped_file_unref (res->map);
+    g_free (res->ids);
+    g_free (res->security);
+    g_free (res);
+}
+
+static void result_changed (GFileMonitor *, GFile *, GFile *, GFileMonitorEvent event, gpointer user_data)
+{
+    if (event == G_FILE_MONITOR_EVENT_CREATED || event == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT)
+        shared_read ((Shared *) user_data, -1);
+}
+
+Shared *shared_new (SharedResultFunc func, gpointer user_data)
+{
+    Shared *sh;
+    GFile *file;
+    char *dir;
+
+    sh = g_new0 (Shared, 1);
+    sh->func = func;
+    sh->user_data = user_data;
+    sh->owner = getuid ();
+
+    dir = shared_dir (&sh->gid);
+    DEBUG ("Sharing results in %s", dir);
+    sh->lock_path = g_build_filename (dir, "leader.lock", NULL);
+    sh->result_path = g_build_filename (dir, "result", NULL);
+    g_free (dir);
+
+    /* a lock can be taken on a file opened for reading, so other users need only read it */
+    sh->lock_fd = open (sh->lock_path, O_RDONLY | O_CREAT | O_CLOEXEC, sh->gid == (gid_t) -1 ? 0600 : 0640);
+    if (sh->lock_fd < 0) WARN ("Unable to open %s - results will not be shared", sh->lock_path);
+
+    file = g_file_new_for_path (sh->result_path);
+    sh->monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, NULL);
+    if (sh->monitor) g_signal_connect (sh->monitor, "changed", G_CALLBACK (result_changed), sh);
+    g_object_unref (file);
+    return sh;
+}
+
+/* Try to become the panel which checks - FALSE means that another panel */
+/* is checking now, and its result will arrive through the monitor       */
+gboolean shared_lead (Shared *sh)
+{
+    if (!sh || sh->leading || sh->lock_fd < 0) return TRUE;
+    if (flock (sh->lock_fd, LOCK_EX | LOCK_NB)) return FALSE;
+    sh->leading = TRUE;
+    return TRUE;
+}
+
+/* Write the result of this panel's check for the others, if it is the leader */
+void shared_publish (Shared *sh, const UpdateSet *set, gint64 written)
+{
+    SharedHeader hdr;
+    GByteArray *buf;
+    int i;
+
+    if (!sh || !sh->leading) return;
+
+    memset (&hdr, 0, sizeof (SharedHeader));
+    memcpy (hdr.magic, SHARED_MAGIC, 4);
+    hdr.version = SHARED_VERSION;
+    hdr.written = written;
+    hdr.pid = getpid ();
+    hdr.n_updates = set->n_updates;
+    hdr.n_security = set->n_security;
+    hdr.fingerprint = set->fingerprint;
+
+    buf = g_byte_array_new ();
+    g_byte_array_append (buf, (const guint8 *) &hdr, sizeof (SharedHeader));
+    for (i = 0; i < set->n_updates; i++)
+    {
+        g_byte_array_append (buf, &set->security[i], 1);
+        g_byte_array_append (buf, (const guint8 *) set->ids[i], strlen (set->ids[i]) + 1);
+    }
+
+    /* written to a temporary file and renamed, so readers never map a partial result */
+    if (!g_file_set_contents_full (sh->result_path, (const char *) buf->data, buf->len, G_FILE_SET_CONTENTS_CONSISTENT,
+        sh->gid == (gid_t) -1 ? 0600 : 0640, NULL))
+        WARN ("Unable to write shared result to %s", sh->result_path);
+    else sh->last_seen = written;
+    g_byte_array_unref (buf);
+}
+
+void shared_release (Shared *sh)
+{
+    if (!sh || !sh->leading) return;
+    flock (sh->lock_fd, LOCK_UN);
+    sh->leading = FALSE;
+}
+
+/* Deliver the shared result if it is newer than any seen so far. Returns */
+/* TRUE if there is a valid result written by another process no older   */
+/* than max_age microseconds, or of any age if max_age is negative. This  */
+/* process's own result never counts - it was written just after its     */
+/* timer was last armed, so would always look fresh at the next tick     */
+gboolean shared_read (Shared *sh, gint64 max_age)
+{
+    SharedResult *res;
+    gboolean fresh, own;
+
+    if (!sh) return FALSE;
+    res = result_load (sh);
+    if (!res) return FALSE;
+
+    fresh = max_age < 0 || clock_real () - res->written <= max_age;
+    if (fresh && res->written > sh->last_seen)
+    {
+        sh->last_seen = res->written;
+        DEBUG ("Using shared result from another panel");
+        sh->func (res, sh->user_data);
+    }
+    own = res->pid == (guint32) getpid ();
+    result_free (res);
+    return fresh && !own;
+}
+
+void shared_free (Shared *sh)
+{
+    if (!sh) return;
+    if (sh->monitor)
+    {
+        g_signal_handlers_disconnect_by_data (sh->monitor, sh);
+        g_object_unref (sh->monitor);
+    }
+    if (sh->lock_fd >= 0) close (sh->lock_fd);
+    g_free (sh->lock_path);
+    g_free (sh->result_path);
+    g_free (sh);
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
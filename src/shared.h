@@ -0,0 +1,87 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#ifndef UPDATER_SHARED_H
+#define UPDATER_SHARED_H
+
+#include <glib.h>
+
+#include "updates.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* The shared result is a fixed header followed by one entry per update - a  */
+/* security flag byte and the NUL-terminated package ID - in host byte order */
+
+#define SHARED_MAGIC "UPDR"
+#define SHARED_VERSION 1
+
+typedef struct
+{
+    char magic[4];
+    guint32 version;
+    gint64 written;                 /* Wall clock time at which the result was written */
+    guint32 pid;                    /* Process which wrote the result */
+    guint32 n_updates;              /* Number of entries which follow */
+    guint32 n_security;             /* Number of entries flagged as security fixes */
+    guint32 reserved;
+    guint64 fingerprint;            /* Fingerprint of the set of updates */
+} SharedHeader;
+
+/* A result read from the file - ids point into the mapping, which stays */
+/* valid until the result is freed                                      */
+typedef struct
+{
+    GMappedFile *map;
+    gint64 written;
+    guint32 pid;
+    int n_updates;
+    const char **ids;
+    guint8 *security;
+} SharedResult;
+
+typedef void (*SharedResultFunc) (const SharedResult *res, gpointer user_data);
+
+typedef struct _Shared Shared;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+extern Shared *shared_new (SharedResultFunc func, gpointer user_data);
+extern gboolean shared_lead (Shared *sh);
+extern void shared_publish (Shared *sh, const UpdateSet *set, gint64 written);
+extern void shared_release (Shared *sh);
+extern gboolean shared_read (Shared *sh, gint64 max_age);
+extern void shared_free (Shared *sh);
+
+#endif
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,283 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gtk/gtk.h>
+
+#include "backend.h"
+#include "check.h"
+#include "updates.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Each step is repeated until it has run for at least this long, in ms */
+#define BENCH_MIN_MS 200
+
+typedef void (*BenchFunc) (gpointer data);
+
+typedef struct
+{
+    PkPackageSack *sack;            /* Unfiltered updates, as a check returns them */
+    UpdateSet *set;                 /* Filtered updates, as the dialog gets them */
+    GtkListStore *store;            /* Filled list, for the tree view step */
+    GtkWidget *view;                /* Tree view in an offscreen window, or NULL without a display */
+    Replay *replay;                 /* Empty check result, for the startup steps */
+} Bench;
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+static const int sizes[] = { 10, 1000, 20000 };
+
+static int min_ms = BENCH_MIN_MS;
+
+static GOptionEntry entries[] =
+{
+    { "min-ms", 'm', 0, G_OPTION_ARG_INT, &min_ms, "Minimum time to repeat each step for", "MS" },
+    { NULL }
+};
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static PkPackageSack *make_sack (int n);
+static gint64 bench_run (BenchFunc func, gpointer data);
+static void bench_construct (gpointer data);
+static void bench_first_idle (gpointer data);
+static void bench_split (gpointer data);
+static void bench_filter (gpointer data);
+static void bench_update_set (gpointer data);
+static GtkListStore *fill_store (const UpdateSet *set);
+static void bench_list_store (gpointer data);
+static void bench_tree_view (gpointer data);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+/* Synthetic updates with the mix the filter sees on an x86 image - some */
+/* amd64 packages, some security updates, and some packages which are    */
+/* already installed and so are filtered out                             */
+static PkPackageSack *make_sack (int n)
+{
+    PkPackageSack *sack = pk_package_sack_new ();
+    PkPackage *pkg;
+    char *id;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        id = g_strdup_printf ("package-%05d;%d.%d.%d-1+deb12u%d;%s;debian-security", i, i % 7, i % 13, i % 31, i % 3,
+            i % 4 ? "arm64" : "amd64");
+        pkg = pk_package_new ();
+        pk_package_set_id (pkg, id, NULL);
+        pk_package_set_info (pkg, i % 10 == 0 ? PK_INFO_ENUM_SECURITY : i % 10 == 1 ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_NORMAL);
+        pk_package_sack_add_package (sack, pkg);
+        g_object_unref (pkg);
+        g_free (id);
+    }
+    return sack;
+}
+
+/* Returns the mean time per run in nanoseconds */
+static gint64 bench_run (BenchFunc func, gpointer data)
+{
+    gint64 start, elapsed;
+    int runs = 0;
+
+    start = g_get_monotonic_time ();
+    do
+    {
+        func (data);
+        runs++;
+        elapsed = g_get_monotonic_time () - start;
+    } while (elapsed < min_ms * 1000L);
+    return elapsed * 1000 / runs;
+}
+
+/* All the backend does while the plugin is constructed */
+static void bench_construct (gpointer)
+{
+    backend_free (backend_new (NULL, NULL));
+}
+
+/* Construction and the first idle, which starts the service, the shared  */
+/* state and the first check - the check is replayed, and detached by the */
+/* free, so only the cost of starting it on the main thread is included    */
+static void bench_first_idle (gpointer data)
+{
+    Bench *b = (Bench *) data;
+    Backend *be = backend_new (NULL, NULL);
+
+    backend_set_replay (be, replay_copy (b->replay), 0);
+    while (g_main_context_iteration (NULL, FALSE));
+    backend_free (be);
+}
+
+/* As the dialog does for each row */
+static void bench_split (gpointer data)
+{
+    Bench *b = (Bench *) data;
+    char buffer[1024], *ver;
+    int i;
+
+    for (i = 0; i < b->set->n_updates; i++)
+        update_id_split (b->set->ids[i], buffer, sizeof (buffer), &ver);
+}
+
+static void bench_filter (gpointer data)
+{
+    Bench *b = (Bench *) data;
+    g_object_unref (pk_package_sack_filter (b->sack, check_filter, NULL));
+}
+
+/* Filtering, hashing and classifying, as the backend does with each result */
+static void bench_update_set (gpointer data)
+{
+    Bench *b = (Bench *) data;
+    update_set_unref (update_set_new (b->sack, b->set, NULL, NULL));
+}
+
+static GtkListStore *fill_store (const UpdateSet *set)
+{
+    GtkListStore *ls = gtk_list_store_new (2, G_TYPE_STRING, G_TYPE_STRING);
+    char buffer[1024], *ver;
+    int i;
+
+    for (i = 0; i < set->n_updates; i++)
+        if (update_id_split (set->ids[i], buffer, sizeof (buffer), &ver))
+            gtk_list_store_insert_with_values (ls, NULL, -1, 0, buffer, 1, ver, -1);
+    return ls;
+}
+
+static void bench_list_store (gpointer data)
+{
+    Bench *b = (Bench *) data;
+    g_object_unref (fill_store (b->set));
+}
+
+/* Setting the model and sizing the view for it, as showing the dialog does */
+static void bench_tree_view (gpointer data)
+{
+    Bench *b = (Bench *) data;
+    GtkRequisition req;
+
+    gtk_tree_view_set_model (GTK_TREE_VIEW (b->view), GTK_TREE_MODEL (b->store));
+    gtk_widget_get_preferred_size (b->view, NULL, &req);
+    gtk_tree_view_set_model (GTK_TREE_VIEW (b->view), NULL);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Entry point                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Times the backend's startup, and the steps between a check result and   */
+/* the list of updates in the dialog at several numbers of updates, and    */
+/* prints the times as JSON. The tree view step needs a display - run      */
+/* headless, it is reported as null, so use a virtual one (xvfb-run, or    */
+/* GDK_BACKEND=broadway) to include it                                     */
+
+int main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    GtkCellRenderer *trend;
+    GtkWidget *win = NULL;
+    GString *str;
+    Bench b;
+    gboolean display;
+    guint i;
+
+    context = g_option_context_new (NULL);
+    g_option_context_set_summary (context, "Time startup, package ID parsing, filtering and update list population.");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "updater-bench: %s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return 1;
+    }
+    g_option_context_free (context);
+
+    display = gtk_init_check (&argc, &argv);
+    memset (&b, 0, sizeof (Bench));
+    if (display)
+    {
+        win = gtk_offscreen_window_new ();
+        b.view = gtk_tree_view_new ();
+        trend = gtk_cell_renderer_text_new ();
+        gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (b.view), -1, "Package", trend, "text", 0, NULL);
+        gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (b.view), -1, "Version", trend, "text", 1, NULL);
+        gtk_container_add (GTK_CONTAINER (win), b.view);
+        gtk_widget_show_all (win);
+    }
+
+    /* checks detached by the first idle step end by themselves */
+    b.replay = replay_new ();
+    str = g_string_new ("{\"startup\":{");
+    g_string_append_printf (str, "\"construct_ns\":%" G_GINT64_FORMAT, bench_run (bench_construct, &b));
+    g_string_append_printf (str, ",\"first_idle_ns\":%" G_GINT64_FORMAT "}", bench_run (bench_first_idle, &b));
+    while (check_count ()) g_main_context_iteration (NULL, TRUE);
+    replay_free (b.replay);
+
+    g_string_append (str, ",\"results\":[");
+    for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+        b.sack = make_sack (sizes[i]);
+        b.set = update_set_new (b.sack, NULL, NULL, NULL);
+        b.store = fill_store (b.set);
+
+        if (i) g_string_append_c (str, ',');
+        g_string_append_printf (str, "{\"packages\":%d,\"updates\":%d", sizes[i], b.set->n_updates);
+        g_string_append_printf (str, ",\"split_ns\":%" G_GINT64_FORMAT, bench_run (bench_split, &b));
+        g_string_append_printf (str, ",\"filter_ns\":%" G_GINT64_FORMAT, bench_run (bench_filter, &b));
+        g_string_append_printf (str, ",\"update_set_ns\":%" G_GINT64_FORMAT, bench_run (bench_update_set, &b));
+        g_string_append_printf (str, ",\"list_store_ns\":%" G_GINT64_FORMAT, bench_run (bench_list_store, &b));
+        if (b.view) g_string_append_printf (str, ",\"tree_view_ns\":%" G_GINT64_FORMAT "}", bench_run (bench_tree_view, &b));
+        else g_string_append (str, ",\"tree_view_ns\":null}");
+
+        g_object_unref (b.store);
+        update_set_unref (b.set);
+        g_object_unref (b.sack);
+    }
+    g_string_append (str, "]}\n");
+    fputs (str->str, stdout);
+    g_string_free (str, TRUE);
+
+    if (win) gtk_widget_destroy (win);
+    return 0;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
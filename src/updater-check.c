@@ -0,0 +1,264 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "check.h"
+#include "history.h"
+#include "updates.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Exit codes - as for the panel, a failed check is not the same as no updates */
+#define EXIT_NO_UPDATES     0
+#define EXIT_ERROR          1
+#define EXIT_UPDATES        2
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+static gboolean no_refresh;
+static gboolean json;
+static gboolean timing;
+static char *filter_name;
+static char *trace_path;
+static gboolean history;
+
+static GOptionEntry entries[] =
+{
+    { "no-refresh", 'n', 0, G_OPTION_ARG_NONE, &no_refresh, "Use the package cache as it is, without refreshing it", NULL },
+    { "json", 'j', 0, G_OPTION_ARG_NONE, &json, "Print the updates as JSON", NULL },
+    { "timing", 't', 0, G_OPTION_ARG_NONE, &timing, "Report the time taken by each step", NULL },
+    { "filter", 'f', 0, G_OPTION_ARG_STRING, &filter_name, "Updates to list - default, security or all", "NAME" },
+    { "replay", 'r', 0, G_OPTION_ARG_FILENAME, &trace_path, "Use a recorded trace instead of PackageKit", "FILE" },
+    { "history", 'H', 0, G_OPTION_ARG_NONE, &history, "Print the recorded checks and installs, instead of checking", NULL },
+    { NULL }
+};
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static void print_text (GPtrArray *pkgs);
+static void print_json (const Replay *rep, GPtrArray *pkgs, int n_security, gint64 filter_us);
+static void print_history (void);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+static void print_text (GPtrArray *pkgs)
+{
+    PkPackage *pkg;
+    guint i;
+
+    for (i = 0; i < pkgs->len; i++)
+    {
+        pkg = PK_PACKAGE (g_ptr_array_index (pkgs, i));
+        printf ("%s %s %s %s\n", pk_package_get_name (pkg), pk_package_get_version (pkg),
+            pk_package_get_arch (pkg), pk_info_enum_to_string (pk_package_get_info (pkg)));
+    }
+}
+
+static void print_json (const Replay *rep, GPtrArray *pkgs, int n_security, gint64 filter_us)
+{
+    PkPackage *pkg;
+    GString *str;
+    guint i;
+
+    str = g_string_new ("{");
+    g_string_append_printf (str, "\"count\":%u,\"security\":%d,", pkgs->len, n_security);
+    if (timing)
+        g_string_append_printf (str, "\"timing\":{\"refresh_us\":%" G_GINT64_FORMAT ",\"query_us\":%" G_GINT64_FORMAT ",\"filter_us\":%" G_GINT64_FORMAT "},",
+            rep->refresh_us, rep->query_us, filter_us);
+    g_string_append (str, "\"updates\":[");
+    for (i = 0; i < pkgs->len; i++)
+    {
+        pkg = PK_PACKAGE (g_ptr_array_index (pkgs, i));
+        if (i) g_string_append_c (str, ',');
+        g_string_append (str, "{\"id\":");
+        update_json_string (str, pk_package_get_id (pkg));
+        g_string_append (str, ",\"name\":");
+        update_json_string (str, pk_package_get_name (pkg));
+        g_string_append (str, ",\"version\":");
+        update_json_string (str, pk_package_get_version (pkg));
+        g_string_append (str, ",\"arch\":");
+        update_json_string (str, pk_package_get_arch (pkg));
+        g_string_append (str, ",\"info\":");
+        update_json_string (str, pk_info_enum_to_string (pk_package_get_info (pkg)));
+        g_string_append_c (str, '}');
+    }
+    g_string_append (str, "]}\n");
+    fputs (str->str, stdout);
+    g_string_free (str, TRUE);
+}
+
+/* Print the history file of the user running the tool, oldest first */
+static void print_history (void)
+{
+    static const char *type_names[] = { "unknown", "check", "install" };
+    const HistoryRecord *rec;
+    HistoryView view;
+    GDateTime *dt;
+    GString *str;
+    char *ts;
+    int i, j;
+
+    /* a missing or unreadable file is an empty history */
+    if (!history_open (&view)) memset (&view, 0, sizeof (HistoryView));
+
+    str = g_string_new (json ? "[" : NULL);
+    for (i = 0; i < view.n_records; i++)
+    {
+        rec = &view.records[i];
+        if (json)
+        {
+            if (i) g_string_append_c (str, ',');
+            g_string_append_printf (str, "{\"type\":\"%s\",\"start\":%" G_GINT64_FORMAT ",\"end\":%" G_GINT64_FORMAT
+                ",\"error\":%s,\"status\":%d,\"count\":%u,\"security\":%u,\"fingerprint\":\"%016" G_GINT64_MODIFIER "x\",\"phase_ms\":[",
+                type_names[rec->type < G_N_ELEMENTS (type_names) ? rec->type : 0], rec->start, rec->end,
+                rec->error ? "true" : "false", rec->status, rec->n_updates, rec->n_security, rec->fingerprint);
+            for (j = 0; j < HISTORY_MAX_PHASES; j++)
+                g_string_append_printf (str, j ? ",%u" : "%u", rec->phase_ms[j]);
+            g_string_append (str, "]}");
+        }
+        else
+        {
+            dt = g_date_time_new_from_unix_local (rec->start / G_USEC_PER_SEC);
+            ts = g_date_time_format (dt, "%F %T");
+            g_string_append_printf (str, "%s %-7s %-6s %5u %5u %8" G_GINT64_FORMAT " ms",
+                ts, type_names[rec->type < G_N_ELEMENTS (type_names) ? rec->type : 0], rec->error ? "failed" : "ok",
+                rec->n_updates, rec->n_security, (rec->end - rec->start) / 1000);
+            if (rec->error) g_string_append_printf (str, " (status %d)", rec->status);
+            g_string_append_c (str, '\n');
+            g_free (ts);
+            g_date_time_unref (dt);
+        }
+    }
+    if (json) g_string_append (str, "]\n");
+    fputs (str->str, stdout);
+    g_string_free (str, TRUE);
+    history_close (&view);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Entry point                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Runs the same check and filter as the panel plugins, and prints the result */
+
+int main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    PkPackageSackFilterFunc filter;
+    PkPackageSack *sack;
+    GPtrArray *pkgs;
+    Replay *rep;
+    gint64 start, filter_us;
+    int n_security, res;
+    guint i;
+
+    context = g_option_context_new (NULL);
+    g_option_context_set_summary (context, "Check for package updates, as the panel updater plugin does.");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "updater-check: %s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return EXIT_ERROR;
+    }
+    g_option_context_free (context);
+
+    if (history)
+    {
+        print_history ();
+        return EXIT_NO_UPDATES;
+    }
+
+    if (!filter_name || !strcmp (filter_name, "default")) filter = check_filter;
+    else if (!strcmp (filter_name, "security")) filter = check_filter_security;
+    else if (!strcmp (filter_name, "all")) filter = NULL;
+    else
+    {
+        fprintf (stderr, "updater-check: unknown filter '%s'\n", filter_name);
+        return EXIT_ERROR;
+    }
+
+    if (trace_path)
+    {
+        rep = replay_load (trace_path);
+        if (!rep)
+        {
+            fprintf (stderr, "updater-check: unable to read trace '%s'\n", trace_path);
+            return EXIT_ERROR;
+        }
+    }
+    else rep = check_run (!no_refresh, NULL);
+
+    if (rep->refresh_error != REPLAY_OK || rep->query_error != REPLAY_OK)
+    {
+        fprintf (stderr, "updater-check: %s failed - PackageKit error %d\n", rep->refresh_error != REPLAY_OK ? "cache refresh" : "update query",
+            rep->refresh_error != REPLAY_OK ? rep->refresh_error : rep->query_error);
+        replay_free (rep);
+        return EXIT_ERROR;
+    }
+
+    /* filtered here rather than in check_run so that the filter can be timed */
+    start = g_get_monotonic_time ();
+    sack = filter ? pk_package_sack_filter (rep->sack, filter, NULL) : g_object_ref (rep->sack);
+    pkgs = pk_package_sack_get_array (sack);
+    n_security = 0;
+    for (i = 0; i < pkgs->len; i++)
+        if (check_is_security (PK_PACKAGE (g_ptr_array_index (pkgs, i)))) n_security++;
+    filter_us = g_get_monotonic_time () - start;
+
+    if (json) print_json (rep, pkgs, n_security, filter_us);
+    else
+    {
+        print_text (pkgs);
+        if (timing)
+            fprintf (stderr, "refresh: %" G_GINT64_FORMAT " us\nquery: %" G_GINT64_FORMAT " us\nfilter: %" G_GINT64_FORMAT " us\n",
+                rep->refresh_us, rep->query_us, filter_us);
+    }
+
+    res = pkgs->len ? EXIT_UPDATES : EXIT_NO_UPDATES;
+    g_ptr_array_unref (pkgs);
+    g_object_unref (sack);
+    replay_free (rep);
+    return res;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,60 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "check.h"
+
+/*----------------------------------------------------------------------------*/
+/* Helper which runs a single check outside the panel                         */
+/*----------------------------------------------------------------------------*/
+
+/* The result is written to stdout in trace format, and the process exits, so */
+/* that PackageKit memory is returned to the system after every check. With   */
+/* --no-refresh the cache is queried as it is. As in any trace, the packages  */
+/* are unfiltered - the plugin filters them as it does for an in-process check */
+
+int main (int argc, char *argv[])
+{
+    Replay *rep;
+    GString *str;
+    int res;
+
+    rep = check_run (argc < 2 || strcmp (argv[1], "--no-refresh"), NULL);
+    str = replay_format (rep);
+    res = fwrite (str->str, 1, str->len, stdout) == str->len ? 0 : 1;
+
+    g_string_free (str, TRUE);
+    replay_free (rep);
+    return res;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
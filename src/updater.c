@@ -26,6 +26,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ============================================================================*/
 
 #include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <glib/gi18n.h>
 
 #ifdef LXPLUG
@@ -35,172 +38,93 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 #include "updater.h"
-
-#define I_KNOW_THE_PACKAGEKIT_GLIB2_API_IS_SUBJECT_TO_CHANGE
-#include <packagekit-glib2/packagekit.h>
+#include "backend.h"
+#include "log.h"
+#include "trace.h"
+#include "replay.h"
+#include "updates.h"
+#include "clock.h"
 
 /*----------------------------------------------------------------------------*/
 /* Typedefs and macros                                                        */
 /*----------------------------------------------------------------------------*/
 
-#define DEBUG_ON
-#ifdef DEBUG_ON
-#define DEBUG(fmt,args...) g_message("up: " fmt,##args)
-#else
-#define DEBUG(fmt,args...)
-#endif
+/* Badge counts above this are all drawn as "9+" */
+#define BADGE_MAX_COUNT 9
 
-#define SECS_PER_HOUR 3600L
+#define BADGE_KEY(size,count,sec) GINT_TO_POINTER (((size) << 8) | ((count) << 1) | ((sec) ? 1 : 0))
 
 /*----------------------------------------------------------------------------*/
 /* Global data                                                                */
 /*----------------------------------------------------------------------------*/
 
+/* Checking state is shared by every instance of the plugin in the process - */
+/* each instance is just a view of the one backend, so that several panels   */
+/* or several copies of the plugin still only check, notify and publish once */
+static Backend *backend;
+
+/* Plugin instances showing the result */
+static GList *views;
+
+/* Sequence number of the notification currently shown */
+static unsigned int notify_seq;
+
 /*----------------------------------------------------------------------------*/
 /* Prototypes                                                                 */
 /*----------------------------------------------------------------------------*/
 
-static gboolean net_available (void);
-static void check_for_updates (gpointer user_data);
-static gpointer refresh_update_cache (gpointer data);
-static void refresh_cache_done (PkTask *task, GAsyncResult *res, gpointer data);
-static gboolean filter_fn (PkPackage *package, gpointer user_data);
-static gboolean filter_fn_x86 (PkPackage *package, gpointer);
-static void check_updates_done (PkTask *task, GAsyncResult *res, gpointer data);
+static void views_changed (gpointer user_data);
+static void views_notify (gboolean security, gpointer user_data);
+static void views_notify_clear (gpointer user_data);
 static void install_updates (GtkWidget *widget, gpointer user_data);
-static void launch_installer (void);
 static void show_updates (GtkWidget *widget, gpointer user_data);
 static void handle_close_update_dialog (GtkButton *button, gpointer user_data);
 static void handle_close_and_install (GtkButton *button, gpointer user_data);
 static gint delete_update_dialog (GtkWidget *widget, GdkEvent *event, gpointer user_data);
 static void show_menu (UpdaterPlugin *up);
 static void hide_menu (UpdaterPlugin *up);
-static void update_icon (UpdaterPlugin *up, gboolean hide);
-static gboolean init_check (gpointer data);
-static gboolean net_check (gpointer data);
-static gboolean periodic_check (gpointer data);
+static int get_icon_size (UpdaterPlugin *up);
+static GdkPixbuf *render_badge (int size, int count, gboolean security);
+static void set_badge_icon (UpdaterPlugin *up);
+static void theme_changed (GtkIconTheme *theme, gpointer user_data);
+static void view_update (UpdaterPlugin *up);
+static gboolean view_init (gpointer data);
 static void updater_button_clicked (GtkWidget *, UpdaterPlugin *up);
+static void control_stats (Backend *be);
+static void merge_settings (Backend *be);
+static Backend *backend_ref (UpdaterPlugin *up);
+static void backend_unref (UpdaterPlugin *up);
 
 /*----------------------------------------------------------------------------*/
 /* Function definitions                                                       */
 /*----------------------------------------------------------------------------*/
 
 /*----------------------------------------------------------------------------*/
-/* Utility functions                                                          */
+/* Backend callbacks                                                          */
 /*----------------------------------------------------------------------------*/
 
-static gboolean net_available (void)
+static void views_changed (gpointer)
 {
-    if (system ("hostname -I | grep -q \\\\.") == 0) return TRUE;
-    else return FALSE;
+    g_list_foreach (views, (GFunc) view_update, NULL);
 }
 
-/*----------------------------------------------------------------------------*/
-/* Handlers for PackageKit asynchronous check for updates                     */
-/*----------------------------------------------------------------------------*/
-
-static void check_for_updates (gpointer user_data)
+/* The notification is the same whichever panel shows it, and replaces the */
+/* previous one rather than stacking up                                     */
+static void views_notify (gboolean security, gpointer)
 {
-    UpdaterPlugin *up = (UpdaterPlugin *) user_data;
-
-    if (!net_available ())
-    {
-        DEBUG ("No network connection - update check failed");
-        return;
-    }
+    const char *msg;
 
-    DEBUG ("Checking for updates");
-    g_thread_new (NULL, refresh_update_cache, up);
-}
+    if (security) msg = _("Security updates are available\nClick the update icon to install");
+    else msg = _("Updates are available\nClick the update icon to install");
 
-static gpointer refresh_update_cache (gpointer data)
-{
-    UpdaterPlugin *up = (UpdaterPlugin *) data;
-    PkTask *task = pk_task_new ();
-    pk_client_refresh_cache_async (PK_CLIENT (task), TRUE, up->cancellable, NULL, NULL, (GAsyncReadyCallback) refresh_cache_done, data);
-    return NULL;
+    if (notify_seq) lxpanel_notify_clear (notify_seq);
+    notify_seq = lxpanel_notify (((UpdaterPlugin *) views->data)->panel, msg);
 }
 
-static void refresh_cache_done (PkTask *task, GAsyncResult *res, gpointer data)
+static void views_notify_clear (gpointer)
 {
-    UpdaterPlugin *up = (UpdaterPlugin *) data;
-    GError *error = NULL;
-    pk_task_generic_finish (task, res, &error);
-
-    if (error != NULL)
-    {
-        DEBUG ("Error updating cache - %s", error->message);
-        g_error_free (error);
-        return;
-    }
-
-    DEBUG ("Cache updated - comparing versions");
-    pk_client_get_updates_async (PK_CLIENT (task), PK_FILTER_ENUM_NONE, up->cancellable, NULL, NULL, (GAsyncReadyCallback) check_updates_done, data);
-}
-
-static gboolean filter_fn (PkPackage *package, gpointer)
-{
-    PkInfoEnum info = pk_package_get_info (package);
-	switch (info)
-    {
-        case PK_INFO_ENUM_LOW:
-        case PK_INFO_ENUM_NORMAL:
-        case PK_INFO_ENUM_IMPORTANT:
-        case PK_INFO_ENUM_SECURITY:
-        case PK_INFO_ENUM_BUGFIX:
-        case PK_INFO_ENUM_ENHANCEMENT:
-        case PK_INFO_ENUM_BLOCKED:      return TRUE;
-                                        break;
-
-        default:                        return FALSE;
-                                        break;
-    }
-}
-
-static gboolean filter_fn_x86 (PkPackage *package, gpointer)
-{
-    if (strstr (pk_package_get_arch (package), "amd64")) return FALSE;
-    return filter_fn (package, NULL);
-}
-
-static void check_updates_done (PkTask *task, GAsyncResult *res, gpointer data)
-{
-    UpdaterPlugin *up = (UpdaterPlugin *) data;
-    PkPackageSack *sack = NULL, *fsack;
-
-    GError *error = NULL;
-    PkResults *results = pk_task_generic_finish (task, res, &error);
-
-    if (error != NULL)
-    {
-        DEBUG ("Error comparing versions - %s", error->message);
-        g_error_free (error);
-        return;
-    }
-
-    sack = pk_results_get_package_sack (results);
-    if (system ("raspi-config nonint is_pi"))
-        fsack = pk_package_sack_filter (sack, filter_fn_x86, data);
-    else
-        fsack = pk_package_sack_filter (sack, filter_fn, data);
-
-    up->n_updates = pk_package_sack_get_size (fsack);
-    if (up->ids != NULL) g_strfreev (up->ids);
-    if (up->n_updates > 0)
-    {
-        DEBUG ("Check complete - %d updates available", up->n_updates);
-        up->ids = pk_package_sack_get_ids (fsack);
-        lxpanel_notify (up->panel, _("Updates are available\nClick the update icon to install"));
-    }
-    else
-    {
-        DEBUG ("Check complete - no updates available");
-        up->ids = NULL;
-    }
-    update_icon (up, FALSE);
-
-    if (sack) g_object_unref (sack);
-    g_object_unref (fsack);
+    if (notify_seq) lxpanel_notify_clear (notify_seq);
+    notify_seq = 0;
 }
 
 
@@ -208,16 +132,14 @@ static void check_updates_done (PkTask *task, GAsyncResult *res, gpointer data)
 /* Launch installer process                                                   */
 /*----------------------------------------------------------------------------*/
 
-static void install_updates (GtkWidget *, gpointer)
+static void install_updates (GtkWidget *, gpointer user_data)
 {
-    launch_installer ();
-}
-
-static void launch_installer (void)
-{
-    char *cmd[2] = {"gui-updater", NULL};
+    UpdaterPlugin *up = (UpdaterPlugin *) user_data;
+    WATCH (up->be);
+    UpdateSet *set = backend_ref_updates (up->be);
 
-    g_spawn_async (NULL, cmd, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, NULL);
+    backend_install (up->be, set);
+    update_set_unref (set);
 }
 
 
@@ -225,15 +147,26 @@ static void launch_installer (void)
 /* Dialog box showing pending updates                                         */
 /*----------------------------------------------------------------------------*/
 
+/* The dialog keeps the set it was opened with, so that the history record  */
+/* of an install started from it matches the list the user saw - the        */
+/* installer itself installs whatever is pending when it runs               */
 static void show_updates (GtkWidget *, gpointer user_data)
 {
     UpdaterPlugin *up = (UpdaterPlugin *) user_data;
+    UpdateSet *updates;
+    WATCH (up->be);
     GtkBuilder *builder;
     GtkWidget *update_list;
     GtkCellRenderer *trend = gtk_cell_renderer_text_new ();
     int count;
-    char buffer[1024], *ptr, *ver;
+    char buffer[1024], *ver;
+#ifdef HAVE_USDT
+    gint64 start = g_get_monotonic_time ();
+#endif
 
+    update_set_unref (up->dlg_updates);
+    updates = up->dlg_updates = backend_ref_updates (up->be);
+    TRACE1 (dialog__open, updates->n_updates);
     textdomain (GETTEXT_PACKAGE);
 
     builder = gtk_builder_new_from_file (PACKAGE_DATA_DIR "/ui/lxplug-updater.ui");
@@ -243,27 +176,24 @@ static void show_updates (GtkWidget *, gpointer user_data)
     g_signal_connect (up->update_dlg, "delete_event", G_CALLBACK (delete_update_dialog), up);
 
     GtkListStore *ls = gtk_list_store_new (2, G_TYPE_STRING, G_TYPE_STRING);
-    count = 0;
-    while (count < up->n_updates)
+    for (count = 0; count < updates->n_updates; count++)
     {
-        g_strlcpy (buffer, up->ids[count], sizeof (buffer));
-        ptr = buffer;
-        while (*ptr != ';') ptr++;
-        *ptr = 0;
-        ptr++;
-        ver = ptr;
-        while (*ptr != ';') ptr++;
-        *ptr = 0;
-        gtk_list_store_insert_with_values (ls, NULL, count, 0, buffer, 1, ver, -1);
-        count++;
+        /* package IDs are "name;version;arch;data" - copy out just the name and version */
+        if (update_id_split (updates->ids[count], buffer, sizeof (buffer), &ver))
+            gtk_list_store_insert_with_values (ls, NULL, -1, 0, buffer, 1, ver, -1);
     }
 
     update_list = (GtkWidget *) gtk_builder_get_object (builder, "update_list");
     gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (update_list), -1, "Package", trend, "text", 0, NULL);
     gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (update_list), -1, "Version", trend, "text", 1, NULL);
     gtk_tree_view_set_model (GTK_TREE_VIEW (update_list), GTK_TREE_MODEL (ls));
+    g_object_unref (ls);
 
     gtk_widget_show_all (up->update_dlg);
+    g_object_unref (builder);
+#ifdef HAVE_USDT
+    TRACE2 (dialog__populated, updates->n_updates, g_get_monotonic_time () - start);
+#endif
 }
 
 static void handle_close_update_dialog (GtkButton *, gpointer user_data)
@@ -274,17 +204,19 @@ static void handle_close_update_dialog (GtkButton *, gpointer user_data)
         gtk_widget_destroy (up->update_dlg);
         up->update_dlg = NULL;
     }
+    update_set_unref (up->dlg_updates);
+    up->dlg_updates = NULL;
 }
 
 static void handle_close_and_install (GtkButton *, gpointer user_data)
 {
     UpdaterPlugin *up = (UpdaterPlugin *) user_data;
-    if (up->update_dlg)
-    {
-        gtk_widget_destroy (up->update_dlg);
-        up->update_dlg = NULL;
-    }
-    launch_installer ();
+    WATCH (up->be);
+    UpdateSet *set = update_set_ref (up->dlg_updates);
+
+    handle_close_update_dialog (NULL, up);
+    backend_install (up->be, set);
+    update_set_unref (set);
 }
 
 static gint delete_update_dialog (GtkWidget *, GdkEvent *, gpointer user_data)
@@ -336,10 +268,110 @@ static void hide_menu (UpdaterPlugin *up)
 /* Icon                                                                       */
 /*----------------------------------------------------------------------------*/
 
-static void update_icon (UpdaterPlugin *up, gboolean hide)
+static int get_icon_size (UpdaterPlugin *up)
+{
+#ifdef LXPLUG
+    return panel_get_safe_icon_size (up->panel);
+#else
+    return up->icon_size;
+#endif
+}
+
+static GdkPixbuf *render_badge (int size, int count, gboolean security)
 {
-    /* if updates are available, show the icon */
-    if (up->n_updates && !hide)
+    GdkPixbuf *icon, *badged;
+    cairo_surface_t *surf;
+    cairo_t *cr;
+    cairo_text_extents_t ext;
+    char label[8];
+    double rad, cx, cy;
+
+    icon = gtk_icon_theme_load_icon (gtk_icon_theme_get_default (), "update-avail", size, GTK_ICON_LOOKUP_FORCE_SIZE, NULL);
+    if (!icon) return NULL;
+
+    surf = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, size, size);
+    cr = cairo_create (surf);
+    gdk_cairo_set_source_pixbuf (cr, icon, (size - gdk_pixbuf_get_width (icon)) / 2.0, (size - gdk_pixbuf_get_height (icon)) / 2.0);
+    cairo_paint (cr);
+    g_object_unref (icon);
+
+    /* circle in the bottom right corner - red for security updates, blue otherwise */
+    rad = size * 0.25;
+    cx = size - rad;
+    cy = size - rad;
+    cairo_arc (cr, cx, cy, rad, 0, 2 * G_PI);
+    if (security) cairo_set_source_rgb (cr, 0.80, 0.10, 0.10);
+    else cairo_set_source_rgb (cr, 0.10, 0.40, 0.80);
+    cairo_fill (cr);
+
+    if (count > BADGE_MAX_COUNT) g_snprintf (label, sizeof (label), "%d+", BADGE_MAX_COUNT);
+    else g_snprintf (label, sizeof (label), "%d", count);
+
+    cairo_select_font_face (cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+    cairo_set_font_size (cr, count > BADGE_MAX_COUNT ? rad : rad * 1.4);
+    cairo_text_extents (cr, label, &ext);
+    cairo_move_to (cr, cx - ext.width / 2 - ext.x_bearing, cy - ext.height / 2 - ext.y_bearing);
+    cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+    cairo_show_text (cr, label);
+    cairo_destroy (cr);
+
+    badged = gdk_pixbuf_get_from_surface (surf, 0, 0, size, size);
+    cairo_surface_destroy (surf);
+    return badged;
+}
+
+/* Badged icons are rendered once per size, count and class and then reused */
+static void set_badge_icon (UpdaterPlugin *up)
+{
+    const UpdateSet *updates;
+    GdkPixbuf *pixbuf;
+    int size, count;
+    gboolean security;
+    gpointer key;
+
+    size = get_icon_size (up);
+    updates = backend_get_updates (up->be);
+    count = MIN (updates->n_updates, BADGE_MAX_COUNT + 1);
+    security = updates->n_security > 0;
+
+    if (count <= 0 || size <= 0)
+    {
+        wrap_set_taskbar_icon (up, up->tray_icon, "update-avail");
+        return;
+    }
+
+    key = BADGE_KEY (size, count, security);
+    pixbuf = g_hash_table_lookup (up->badges, key);
+    if (!pixbuf)
+    {
+        pixbuf = render_badge (size, count, security);
+        if (!pixbuf)
+        {
+            wrap_set_taskbar_icon (up, up->tray_icon, "update-avail");
+            return;
+        }
+        g_hash_table_insert (up->badges, key, pixbuf);
+    }
+    gtk_image_set_from_pixbuf (GTK_IMAGE (up->tray_icon), pixbuf);
+}
+
+static void theme_changed (GtkIconTheme *, gpointer user_data)
+{
+    UpdaterPlugin *up = (UpdaterPlugin *) user_data;
+    WATCH (up->be);
+    g_hash_table_remove_all (up->badges);
+    set_badge_icon (up);
+}
+
+/* The button is only shown or hidden when its visibility actually changes */
+static void view_update (UpdaterPlugin *up)
+{
+    gboolean visible = backend_result_visible (up->be);
+
+    if (visible) set_badge_icon (up);
+    if (visible == up->shown) return;
+
+    if (visible)
     {
         gtk_widget_show_all (up->plugin);
         gtk_widget_set_sensitive (up->plugin, TRUE);
@@ -349,6 +381,9 @@ static void update_icon (UpdaterPlugin *up, gboolean hide)
         gtk_widget_hide (up->plugin);
         gtk_widget_set_sensitive (up->plugin, FALSE);
     }
+    up->shown = visible;
+    up->relayouts++;
+    DEBUG ("Icon %s - %u panel relayouts", visible ? "shown" : "hidden", up->relayouts);
 }
 
 
@@ -356,42 +391,119 @@ static void update_icon (UpdaterPlugin *up, gboolean hide)
 /* Timer handlers                                                             */
 /*----------------------------------------------------------------------------*/
 
-static gboolean init_check (gpointer data)
+/* Each view is brought up to date once its panel has finished constructing */
+static gboolean view_init (gpointer data)
 {
     UpdaterPlugin *up = (UpdaterPlugin *) data;
+    WATCH (up->be);
     up->idle_timer = 0;
-    update_icon (up, TRUE);
 
-    /* Don't bother with the check if the wizard is running - it checks anyway... */
-    if (!system ("ps ax | grep -v grep | grep -q piwiz")) return FALSE;
+    /* the panel may have shown the button itself since it was constructed */
+    up->shown = gtk_widget_get_visible (up->plugin);
+    view_update (up);
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Control message replies                                                    */
+/*----------------------------------------------------------------------------*/
 
-    if (net_available ()) check_for_updates (up);
-    else
+/* Panel control messages have no reply channel, so replies are written to a */
+/* file in the runtime directory - it is replaced atomically, so a reader    */
+/* never sees a partial reply                                                */
+void updater_control_reply (const char *text, gsize len)
+{
+    char *path = g_build_filename (g_get_user_runtime_dir (), "lxplug-updater.reply", NULL);
+    if (!g_file_set_contents (path, text, len, NULL)) WARN ("Unable to write reply to %s", path);
+    g_free (path);
+}
+
+/* Stats are written as a control reply, so that scripts can read them, */
+/* and to the journal for anyone reading it                             */
+static void control_stats (Backend *be)
+{
+    UpdaterPlugin *up;
+    GString *str;
+    GList *l;
+    int i;
+
+    str = g_string_new (NULL);
+    backend_stats (be, str);
+    for (l = views, i = 0; l; l = l->next, i++)
     {
-        DEBUG ("No network connection - polling...");
-        up->idle_timer = g_timeout_add_seconds (60, net_check, up);
+        up = (UpdaterPlugin *) l->data;
+        g_string_append_printf (str, "view %d startup=%" G_GINT64_FORMAT "us relayouts=%u\n", i, up->init_us, up->relayouts);
     }
-    return FALSE;
+
+    updater_control_reply (str->str, str->len);
+    g_message ("up: stats:\n%s", str->str);
+    g_string_free (str, TRUE);
 }
 
-static gboolean net_check (gpointer data)
+/*----------------------------------------------------------------------------*/
+/* Backend shared between plugin instances                                    */
+/*----------------------------------------------------------------------------*/
+
+/* Settings which belong to the backend are merged from the settings of all */
+/* of its views - a check is isolated if any view asks for it, metrics go   */
+/* to the first file named, and the shortest non-zero interval wins         */
+static void merge_settings (Backend *be)
 {
-    UpdaterPlugin *up = (UpdaterPlugin *) data;
-    if (net_available ())
+    UpdaterPlugin *up;
+    GList *l;
+    const char *prom_file = NULL;
+    gboolean isolate = FALSE;
+    int interval = 0;
+
+    for (l = views; l; l = l->next)
     {
-        up->idle_timer = 0;
-        check_for_updates (up);
-        return FALSE;
+        up = (UpdaterPlugin *) l->data;
+        if (up->interval > 0 && (!interval || up->interval < interval)) interval = up->interval;
+        if (up->isolate) isolate = TRUE;
+        if (!prom_file && up->prom_file && *up->prom_file) prom_file = up->prom_file;
     }
-    DEBUG ("No network connection - polling...");
-    return TRUE;
+
+    backend_set_interval (be, interval);
+    backend_set_isolate (be, isolate);
+    backend_set_prom_file (be, prom_file);
 }
 
-static gboolean periodic_check (gpointer data)
+/* The first instance creates the backend, and later ones just add a view */
+static Backend *backend_ref (UpdaterPlugin *up)
 {
-    UpdaterPlugin *up = (UpdaterPlugin *) data;
-    check_for_updates (up);
-    return TRUE;
+    static const BackendFuncs funcs = { views_changed, views_notify, views_notify_clear };
+    const char *path = g_getenv ("UPDATER_REPLAY");
+    Replay *rep;
+
+    if (!backend)
+    {
+        backend = backend_new (&funcs, NULL);
+        if (path)
+        {
+            rep = replay_load (path);
+            if (!rep) WARN ("Unable to load replay file %s", path);
+            else backend_set_replay (backend, rep, g_getenv ("UPDATER_REPLAY_SPEED") ? g_ascii_strtod (g_getenv ("UPDATER_REPLAY_SPEED"), NULL) : 1.0);
+        }
+    }
+    else DEBUG ("Sharing backend with %d other instances", g_list_length (views));
+
+    views = g_list_append (views, up);
+    return backend;
+}
+
+static void backend_unref (UpdaterPlugin *up)
+{
+    views = g_list_remove (views, up);
+    if (views)
+    {
+        merge_settings (up->be);
+        return;
+    }
+
+    if (notify_seq) lxpanel_notify_clear (notify_seq);
+    notify_seq = 0;
+    backend_free (up->be);
+    backend = NULL;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -401,6 +513,7 @@ static gboolean periodic_check (gpointer data)
 /* Handler for button click */
 static void updater_button_clicked (GtkWidget *, UpdaterPlugin *up)
 {
+    WATCH (up->be);
     CHECK_LONGPRESS
     show_menu (up);
 }
@@ -408,42 +521,98 @@ static void updater_button_clicked (GtkWidget *, UpdaterPlugin *up)
 /* Handler for system config changed message from panel */
 void updater_update_display (UpdaterPlugin *up)
 {
-    wrap_set_taskbar_icon (up, up->tray_icon, "update-avail");
+    WATCH (up->be);
+
+    /* the icon is only needed while it is shown - view_update loads it when it is */
+    if (backend_get_updates (up->be)->n_updates) set_badge_icon (up);
 }
 
-/* Handler for control message */
+/* Handler for control message - every instance controls the same backend */
 gboolean updater_control_msg (UpdaterPlugin *up, const char *cmd)
 {
-    if (!strncmp (cmd, "check", 5))
+    Backend *be = up->be;
+    GString *str;
+    WATCH (be);
+    if (!strcmp (cmd, "check"))
+    {
+        backend_check (be, TRUE);
+        return TRUE;
+    }
+
+    if (!strcmp (cmd, "check --no-refresh"))
+    {
+        backend_check (be, FALSE);
+        return TRUE;
+    }
+
+    if (!strcmp (cmd, "cancel"))
+    {
+        backend_cancel (be);
+        return TRUE;
+    }
+
+    if (!strcmp (cmd, "status") || !strcmp (cmd, "json"))
+    {
+        str = g_string_new (NULL);
+        if (!strcmp (cmd, "json")) backend_json (be, str);
+        else backend_status (be, str);
+        updater_control_reply (str->str, str->len);
+        g_string_free (str, TRUE);
+        return TRUE;
+    }
+
+    if (!strcmp (cmd, "stats"))
+    {
+        control_stats (be);
+        return TRUE;
+    }
+
+    if (!strncmp (cmd, "record ", 7))
+    {
+        backend_record (be, cmd + 7);
+        return TRUE;
+    }
+
+    if (!strncmp (cmd, "log-level ", 10)) return log_set_level (cmd + 10);
+
+    if (!strncmp (cmd, "log-journal ", 12))
     {
-        update_icon (up, TRUE);
-        check_for_updates (up);
+        log_set_journal (!strcmp (cmd + 12, "on"));
+        return TRUE;
+    }
+
+    if (!strcmp (cmd, "log"))
+    {
+        log_dump ();
         return TRUE;
     }
 
     return FALSE;
 }
 
-/* Handler for interval update from variable watcher */
-void updater_set_interval (UpdaterPlugin *up)
+/* Handler for a change to the interval, isolation or metrics settings - */
+/* called before updater_init too, when there is no backend to apply to  */
+void updater_set_options (UpdaterPlugin *up)
 {
-    if (up->timer) g_source_remove (up->timer);
-    if (up->interval)
-        up->timer = g_timeout_add_seconds (up->interval * SECS_PER_HOUR, periodic_check, up);
-    else
-        up->timer = 0;
+    if (!up->be) return;
+    WATCH (up->be);
+    merge_settings (up->be);
 }
 
 void updater_init (UpdaterPlugin *up)
 {
+    gint64 start = g_get_monotonic_time ();
+
     setlocale (LC_ALL, "");
     bindtextdomain (GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR);
     bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+    log_init ();
 
     /* Allocate icon as a child of top level */
+    up->badges = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_object_unref);
+    up->theme_handler = g_signal_connect (gtk_icon_theme_get_default (), "changed", G_CALLBACK (theme_changed), up);
     up->tray_icon = gtk_image_new ();
     gtk_container_add (GTK_CONTAINER (up->plugin), up->tray_icon);
-    wrap_set_taskbar_icon (up, up->tray_icon, "update-avail");
     gtk_widget_set_tooltip_text (up->tray_icon, _("Updates are available - click to install"));
 
     /* Set up button */
@@ -458,25 +627,32 @@ void updater_init (UpdaterPlugin *up)
     /* Set up variables */
     up->menu = NULL;
     up->update_dlg = NULL;
-    up->n_updates = 0;
-    up->ids = NULL;
-    up->cancellable = g_cancellable_new ();
+    up->dlg_updates = NULL;
+    up->relayouts = 0;
+    up->be = backend_ref (up);
 
     /* Start timed events to monitor status */
-    updater_set_interval (up);
-    up->idle_timer = g_idle_add (init_check, up);
+    updater_set_options (up);
+    up->idle_timer = clock_idle_add (view_init, up);
+
+    /* The button stays hidden, and its icon unloaded, until a check finds updates */
+    gtk_widget_show (up->tray_icon);
+    up->shown = FALSE;
 
-    /* Show the widget and return. */
-    gtk_widget_show_all (up->plugin);
+    up->init_us = g_get_monotonic_time () - start;
 }
 
 void updater_destructor (gpointer user_data)
 {
     UpdaterPlugin *up = (UpdaterPlugin *) user_data;
 
-    g_cancellable_cancel (up->cancellable);
-    if (up->timer) g_source_remove (up->timer);
-    if (up->idle_timer) g_source_remove (up->idle_timer);
+    if (up->idle_timer) clock_source_remove (up->idle_timer);
+    handle_close_update_dialog (NULL, up);
+    hide_menu (up);
+    backend_unref (up);
+    if (up->theme_handler) g_signal_handler_disconnect (gtk_icon_theme_get_default (), up->theme_handler);
+    g_hash_table_destroy (up->badges);
+    g_free (up->prom_file);
 
 #ifndef LXPLUG
     if (up->gesture) g_object_unref (up->gesture);
@@ -496,6 +672,7 @@ static GtkWidget *updater_constructor (LXPanel *panel, config_setting_t *setting
 {
     /* Allocate and initialize plugin context */
     UpdaterPlugin *up = g_new0 (UpdaterPlugin, 1);
+    const char *str;
 
     /* Allocate top level widget and set into plugin widget pointer. */
     up->panel = panel;
@@ -505,6 +682,8 @@ static GtkWidget *updater_constructor (LXPanel *panel, config_setting_t *setting
 
     /* Read config */
     if (!config_setting_lookup_int (up->settings, "Interval", &up->interval)) up->interval = 24;
+    if (config_setting_lookup_string (up->settings, "PromFile", &str)) up->prom_file = g_strdup (str);
+    if (!config_setting_lookup_int (up->settings, "Isolate", &up->isolate)) up->isolate = 0;
 
     updater_init (up);
 
@@ -545,7 +724,7 @@ static gboolean updater_apply_configuration (gpointer user_data)
 
     config_group_set_int (up->settings, "Interval", up->interval);
 
-    updater_set_interval (up);
+    updater_set_options (up);
     return FALSE;
 }
 
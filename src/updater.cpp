@@ -25,9 +25,16 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ============================================================================*/
 
+#include <cstring>
+#include <string>
+#include <vector>
 #include <glibmm.h>
 #include "updater.hpp"
 
+extern "C" {
+#include "check.h"
+}
+
 extern "C" {
     WayfireWidget *create () { return new WayfireUpdater; }
     void destroy (WayfireWidget *w) { delete w; }
@@ -41,6 +48,263 @@ extern "C" {
     const char *package_name (void) { return GETTEXT_PACKAGE; };
 }
 
+/*----------------------------------------------------------------------------*/
+/* Awaitable PackageKit calls                                                 */
+/*----------------------------------------------------------------------------*/
+
+pk::Job::Job (GCancellable *cancellable) : cancellable (G_CANCELLABLE (g_object_ref (cancellable)))
+{
+}
+
+pk::Job &pk::Job::operator= (Job &&other) noexcept
+{
+    cancel ();
+    cancellable = std::move (other.cancellable);
+    return *this;
+}
+
+pk::Job::~Job ()
+{
+    cancel ();
+}
+
+/* Cancelling a job which has ended does nothing */
+void pk::Job::cancel (void)
+{
+    if (cancellable) g_cancellable_cancel (cancellable.get ());
+    cancellable.reset ();
+}
+
+void pk::Call::await_suspend (std::coroutine_handle <Job::promise_type> handle)
+{
+    this->handle = handle;
+    start (handle.promise ().cancellable.get (), finished, this);
+}
+
+/* Called from the main loop, never from within start, so the job is always */
+/* suspended when it is resumed                                             */
+void pk::Call::finished (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+    Call *call = static_cast <Call *> (user_data);
+    GError *error = NULL;
+    PkError *pk_error;
+
+    call->result.results.reset (pk_client_generic_finish (PK_CLIENT (source), res, &error));
+    if (!error && (pk_error = pk_results_get_error_code (call->result.results.get ())))
+    {
+        error = g_error_new_literal (PK_CLIENT_ERROR, pk_error_get_code (pk_error), pk_error_get_details (pk_error));
+        g_object_unref (pk_error);
+    }
+    if (error) call->result.results.reset ();
+    call->result.error.reset (error);
+    call->result.cancelled = g_cancellable_is_cancelled (call->handle.promise ().cancellable.get ());
+    call->handle.resume ();
+}
+
+pk::Call pk::refresh_cache (PkClient *client, bool force)
+{
+    return Call ([=] (GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+    {
+        pk_client_refresh_cache_async (client, force, cancellable, NULL, NULL, callback, user_data);
+    });
+}
+
+pk::Call pk::get_updates (PkClient *client)
+{
+    return Call ([=] (GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+    {
+        pk_client_get_updates_async (client, pk_bitfield_value (PK_FILTER_ENUM_NONE), cancellable, NULL, NULL, callback, user_data);
+    });
+}
+
+/* The IDs are copied by PackageKit when the call starts */
+pk::Call pk::get_details (PkClient *client, gchar **package_ids)
+{
+    return Call ([=] (GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+    {
+        pk_client_get_details_async (client, package_ids, cancellable, NULL, NULL, callback, user_data);
+    });
+}
+
+/* What updating the packages would install, update and remove, without */
+/* changing anything                                                    */
+pk::Call pk::simulate_update (PkClient *client, gchar **package_ids)
+{
+    return Call ([=] (GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+    {
+        pk_client_update_packages_async (client, pk_bitfield_value (PK_TRANSACTION_FLAG_ENUM_SIMULATE), package_ids,
+            cancellable, NULL, NULL, callback, user_data);
+    });
+}
+
+/*----------------------------------------------------------------------------*/
+/* Install preview                                                            */
+/*----------------------------------------------------------------------------*/
+
+struct PreviewUpdate
+{
+    std::string id;
+    std::string summary;
+    guint64 size;
+};
+
+/* The IDs of the updates the plugin would install, with the same filter */
+/* as its checks, as a NULL-terminated array                             */
+static pk::Strv update_ids (PkResults *results)
+{
+    GPtrArray *pkgs = pk_results_get_package_array (results);
+    gchar **ids = g_new0 (gchar *, pkgs->len + 1);
+    PkPackage *pkg;
+    guint i, n = 0;
+
+    for (i = 0; i < pkgs->len; i++)
+    {
+        pkg = PK_PACKAGE (g_ptr_array_index (pkgs, i));
+        if (check_filter (pkg, NULL)) ids[n++] = g_strdup (pk_package_get_id (pkg));
+    }
+    g_ptr_array_unref (pkgs);
+    return pk::Strv (ids);
+}
+
+static void preview_json_ids (GString *str, const char *name, const std::vector <std::string> &ids)
+{
+    bool first = true;
+
+    g_string_append_printf (str, ",\"%s\":[", name);
+    for (const std::string &id : ids)
+    {
+        if (!first) g_string_append_c (str, ',');
+        update_json_string (str, id.c_str ());
+        first = false;
+    }
+    g_string_append_c (str, ']');
+}
+
+static void preview_reply (const std::vector <PreviewUpdate> &updates, const std::vector <std::string> &install,
+    const std::vector <std::string> &remove)
+{
+    GString *str = g_string_new ("{\"updates\":[");
+    guint64 total = 0;
+    bool first = true;
+
+    for (const PreviewUpdate &update : updates)
+    {
+        if (!first) g_string_append_c (str, ',');
+        g_string_append (str, "{\"id\":");
+        update_json_string (str, update.id.c_str ());
+        g_string_append (str, ",\"summary\":");
+        update_json_string (str, update.summary.c_str ());
+        g_string_append_printf (str, ",\"size\":%" G_GUINT64_FORMAT "}", update.size);
+        total += update.size;
+        first = false;
+    }
+    g_string_append_printf (str, "],\"size\":%" G_GUINT64_FORMAT, total);
+    preview_json_ids (str, "install", install);
+    preview_json_ids (str, "remove", remove);
+    g_string_append (str, "}\n");
+    updater_control_reply (str->str, str->len);
+    g_string_free (str, TRUE);
+}
+
+static void preview_error (const char *step, const pk::Result &res)
+{
+    GString *str = g_string_new ("{\"error\":");
+
+    update_json_string (str, step);
+    g_string_append_printf (str, ",\"code\":%d,\"message\":", res.error->code);
+    update_json_string (str, res.error->message);
+    g_string_append (str, "}\n");
+    updater_control_reply (str->str, str->len);
+    g_string_free (str, TRUE);
+}
+
+/* What installing the updates would do - the summary and size of each, and */
+/* the packages the install would add or remove - written as the control    */
+/* reply. A cancelled call ends the preview with nothing written; it uses   */
+/* no plugin state, so it can safely finish after the plugin has gone       */
+static pk::Job preview (bool refresh)
+{
+    pk::Ref <PkClient> client (pk_client_new ());
+    std::vector <PreviewUpdate> updates;
+    std::vector <std::string> install, remove;
+    pk::Result res;
+    pk::Strv ids;
+    GPtrArray *arr;
+    guint i;
+
+    if (refresh)
+    {
+        res = co_await pk::refresh_cache (client.get (), false);
+        if (res.cancelled) co_return;
+        if (!res)
+        {
+            preview_error ("refresh", res);
+            co_return;
+        }
+    }
+
+    res = co_await pk::get_updates (client.get ());
+    if (res.cancelled) co_return;
+    if (!res)
+    {
+        preview_error ("query", res);
+        co_return;
+    }
+
+    ids = update_ids (res.results.get ());
+    if (ids[0])
+    {
+        res = co_await pk::get_details (client.get (), ids.get ());
+        if (res.cancelled) co_return;
+        if (!res)
+        {
+            preview_error ("details", res);
+            co_return;
+        }
+
+        arr = pk_results_get_details_array (res.results.get ());
+        for (i = 0; i < arr->len; i++)
+        {
+            PkDetails *details = PK_DETAILS (g_ptr_array_index (arr, i));
+            const char *summary = pk_details_get_summary (details);
+            updates.push_back ({pk_details_get_package_id (details), summary ? summary : "", pk_details_get_size (details)});
+        }
+        g_ptr_array_unref (arr);
+
+        res = co_await pk::simulate_update (client.get (), ids.get ());
+        if (res.cancelled) co_return;
+        if (!res)
+        {
+            preview_error ("simulate", res);
+            co_return;
+        }
+
+        arr = pk_results_get_package_array (res.results.get ());
+        for (i = 0; i < arr->len; i++)
+        {
+            PkPackage *pkg = PK_PACKAGE (g_ptr_array_index (arr, i));
+            switch (pk_package_get_info (pkg))
+            {
+                case PK_INFO_ENUM_INSTALLING:   install.push_back (pk_package_get_id (pkg));
+                                                break;
+
+                case PK_INFO_ENUM_REMOVING:
+                case PK_INFO_ENUM_OBSOLETING:   remove.push_back (pk_package_get_id (pkg));
+                                                break;
+
+                default:                        break;
+            }
+        }
+        g_ptr_array_unref (arr);
+    }
+
+    preview_reply (updates, install, remove);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Plugin class                                                               */
+/*----------------------------------------------------------------------------*/
+
 void WayfireUpdater::bar_pos_changed_cb (void)
 {
     if ((std::string) bar_pos == "bottom") up->bottom = TRUE;
@@ -53,9 +317,17 @@ void WayfireUpdater::icon_size_changed_cb (void)
     updater_update_display (up);
 }
 
+/* A new preview replaces one still running, and "cancel" stops it along */
+/* with any check                                                         */
 void WayfireUpdater::command (const char *cmd)
 {
-    updater_control_msg (up, cmd);
+    if (!strcmp (cmd, "preview")) preview_job = preview (false);
+    else if (!strcmp (cmd, "preview --refresh")) preview_job = preview (true);
+    else
+    {
+        if (!strcmp (cmd, "cancel")) preview_job.cancel ();
+        updater_control_msg (up, cmd);
+    }
 }
 
 bool WayfireUpdater::set_icon (void)
@@ -67,7 +339,20 @@ bool WayfireUpdater::set_icon (void)
 void WayfireUpdater::settings_changed_cb (void)
 {
     up->interval = interval;
-    updater_set_interval (up);
+    updater_set_options (up);
+}
+
+void WayfireUpdater::prom_file_changed_cb (void)
+{
+    g_free (up->prom_file);
+    up->prom_file = g_strdup (((std::string) prom_file).c_str ());
+    updater_set_options (up);
+}
+
+void WayfireUpdater::isolate_changed_cb (void)
+{
+    up->isolate = isolate;
+    updater_set_options (up);
 }
 
 void WayfireUpdater::init (Gtk::HBox *container)
@@ -83,6 +368,8 @@ void WayfireUpdater::init (Gtk::HBox *container)
     up->icon_size = icon_size;
     icon_timer = Glib::signal_idle().connect (sigc::mem_fun (*this, &WayfireUpdater::set_icon));
     bar_pos_changed_cb ();
+    prom_file_changed_cb ();
+    isolate_changed_cb ();
 
     /* Initialise the plugin */
     updater_init (up);
@@ -92,6 +379,8 @@ void WayfireUpdater::init (Gtk::HBox *container)
     bar_pos.set_callback (sigc::mem_fun (*this, &WayfireUpdater::bar_pos_changed_cb));
 
     interval.set_callback (sigc::mem_fun (*this, &WayfireUpdater::settings_changed_cb));
+    prom_file.set_callback (sigc::mem_fun (*this, &WayfireUpdater::prom_file_changed_cb));
+    isolate.set_callback (sigc::mem_fun (*this, &WayfireUpdater::isolate_changed_cb));
 }
 
 WayfireUpdater::~WayfireUpdater()
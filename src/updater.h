@@ -45,12 +45,17 @@ typedef struct
     GtkWidget *tray_icon;           /* Displayed image */
     GtkWidget *menu;                /* Popup menu */
     GtkWidget *update_dlg;          /* Widget used to display pending update list */
-    int n_updates;                  /* Number of pending updates */
-    gchar **ids;                    /* ID strings for pending updates */
+    struct _UpdateSet *dlg_updates; /* Updates shown in the dialog, held while it is open */
     int interval;                   /* Number of hours between periodic checks */
-    guint timer;                    /* Periodic check timer ID */
+    int isolate;                    /* Whether to run checks in a helper process */
+    char *prom_file;                /* Path of Prometheus textfile to write, or NULL */
     guint idle_timer;
-    GCancellable *cancellable;
+    struct _Backend *be;            /* Checking backend shared by all instances in the process */
+    gint64 init_us;                 /* Time taken to construct the plugin */
+    gboolean shown;                 /* Whether the button is currently shown */
+    guint relayouts;                /* Number of panel relayouts caused by showing or hiding the button */
+    GHashTable *badges;             /* Pre-rendered badged icons, keyed on size, count and class */
+    gulong theme_handler;           /* Icon theme changed signal handler ID */
 } UpdaterPlugin;
 
 /*----------------------------------------------------------------------------*/
@@ -59,8 +64,9 @@ typedef struct
 
 extern void updater_init (UpdaterPlugin *up);
 extern void updater_update_display (UpdaterPlugin *up);
-extern void updater_set_interval (UpdaterPlugin *up);
+extern void updater_set_options (UpdaterPlugin *up);
 extern gboolean updater_control_msg (UpdaterPlugin *up, const char *cmd);
+extern void updater_control_reply (const char *text, gsize len);
 extern void updater_destructor (gpointer user_data);
 
 /* End of file */
@@ -28,14 +28,113 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef WIDGETS_UPDATER_HPP
 #define WIDGETS_UPDATER_HPP
 
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <widget.hpp>
 #include <gtkmm/button.h>
 
 extern "C" {
 #include "lxutils.h"
 #include "updater.h"
+#include "updates.h"
 }
 
+/*----------------------------------------------------------------------------*/
+/* Awaitable PackageKit calls                                                 */
+/*----------------------------------------------------------------------------*/
+
+/* A sequence of PackageKit calls is written as one coroutine returning a */
+/* pk::Job, which awaits each call in turn. Every call made by the job     */
+/* shares its cancellable, so dropping the job cancels whichever call is  */
+/* outstanding; the coroutine should then return as soon as it sees that  */
+/* its result was cancelled. Results and errors are owned by the result,  */
+/* so nothing is leaked on any path out of the coroutine                  */
+
+namespace pk
+{
+    struct ObjectUnref { void operator() (gpointer obj) const { g_object_unref (obj); } };
+    struct ErrorFree { void operator() (GError *error) const { g_error_free (error); } };
+    struct StrvFree { void operator() (gchar **strv) const { g_strfreev (strv); } };
+
+    template <typename T> using Ref = std::unique_ptr <T, ObjectUnref>;
+    using Error = std::unique_ptr <GError, ErrorFree>;
+    using Strv = std::unique_ptr <gchar *[], StrvFree>;
+
+    /* The results of a call, or its error - a failed transaction is an error */
+    /* too, so results are only set if the call succeeded                     */
+    struct Result
+    {
+        Ref <PkResults> results;
+        Error error;
+        bool cancelled = false;     /* Set if the job was cancelled while the call ran */
+
+        explicit operator bool () const { return results && !error; }
+    };
+
+    /* Handle to a running job - the job starts when it is called, runs from */
+    /* the main loop after its first call, and frees itself when it ends     */
+    class Job
+    {
+      public:
+        struct promise_type
+        {
+            Ref <GCancellable> cancellable {g_cancellable_new ()};
+
+            Job get_return_object () { return Job (cancellable.get ()); }
+            std::suspend_never initial_suspend () noexcept { return {}; }
+            std::suspend_never final_suspend () noexcept { return {}; }
+            void return_void () noexcept {}
+            void unhandled_exception () noexcept { std::terminate (); }
+        };
+
+        Job () = default;
+        Job (Job &&other) noexcept = default;
+        Job &operator= (Job &&other) noexcept;
+        ~Job ();
+
+        void cancel (void);
+
+      private:
+        explicit Job (GCancellable *cancellable);
+
+        Ref <GCancellable> cancellable;
+    };
+
+    /* One asynchronous call, started when it is awaited, which resumes the */
+    /* job with its result once it has finished                             */
+    class Call
+    {
+      public:
+        using Start = std::function <void (GCancellable *, GAsyncReadyCallback, gpointer)>;
+
+        explicit Call (Start start) : start (std::move (start)) {}
+        Call (const Call &) = delete;
+        Call &operator= (const Call &) = delete;
+
+        bool await_ready () const noexcept { return false; }
+        void await_suspend (std::coroutine_handle <Job::promise_type> handle);
+        Result await_resume () { return std::move (result); }
+
+      private:
+        static void finished (GObject *source, GAsyncResult *res, gpointer user_data);
+
+        Start start;
+        std::coroutine_handle <Job::promise_type> handle;
+        Result result;
+    };
+
+    Call refresh_cache (PkClient *client, bool force);
+    Call get_updates (PkClient *client);
+    Call get_details (PkClient *client, gchar **package_ids);
+    Call simulate_update (PkClient *client, gchar **package_ids);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Plugin class                                                               */
+/*----------------------------------------------------------------------------*/
+
 class WayfireUpdater : public WayfireWidget
 {
     std::unique_ptr <Gtk::Button> plugin;
@@ -45,10 +144,15 @@ class WayfireUpdater : public WayfireWidget
     sigc::connection icon_timer;
 
     WfOption <int> interval {"panel/updater_interval"};
+    WfOption <std::string> prom_file {"panel/updater_prom_file"};
+    WfOption <bool> isolate {"panel/updater_isolate"};
 
     /* plugin */
     UpdaterPlugin *up;
 
+    /* install preview being run for the "preview" control message */
+    pk::Job preview_job;
+
   public:
 
     void init (Gtk::HBox *container) override;
@@ -58,6 +162,8 @@ class WayfireUpdater : public WayfireWidget
     void bar_pos_changed_cb (void);
     bool set_icon (void);
     void settings_changed_cb (void);
+    void prom_file_changed_cb (void);
+    void isolate_changed_cb (void);
 };
 
 #endif /* end of include guard: WIDGETS_UPDATER_HPP */
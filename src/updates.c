@@ -0,0 +1,230 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "check.h"
+#include "updates.h"
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static guint64 hash_id (const char *id);
+static int compare_hashes (gconstpointer a, gconstpointer b);
+static UpdateSet *set_begin (guint max, GPtrArray **ids, int *new_security, int *new_other);
+static void set_add (UpdateSet *set, GPtrArray *ids, const char *id, gboolean security, const UpdateSet *prev, int *new_security, int *new_other);
+static UpdateSet *set_end (UpdateSet *set, GPtrArray *ids);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+/* FNV-1a, with a final mix so that hashes can be summed into a set fingerprint */
+static guint64 hash_id (const char *id)
+{
+    guint64 hash = 0xcbf29ce484222325ULL;
+
+    while (*id)
+    {
+        hash ^= (guchar) *id++;
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static int compare_hashes (gconstpointer a, gconstpointer b)
+{
+    guint64 ha = *(const guint64 *) a, hb = *(const guint64 *) b;
+    return ha < hb ? -1 : ha > hb ? 1 : 0;
+}
+
+/* Sets are built in one pass - each update is hashed, counted and compared */
+/* against the previous set as it is added                                  */
+static UpdateSet *set_begin (guint max, GPtrArray **ids, int *new_security, int *new_other)
+{
+    UpdateSet *set = g_new0 (UpdateSet, 1);
+
+    set->refs = 1;
+    if (new_security) *new_security = 0;
+    if (new_other) *new_other = 0;
+    *ids = g_ptr_array_sized_new (max + 1);
+    set->hashes = g_new (guint64, max + 1);
+    set->security = g_new (guint8, max + 1);
+    return set;
+}
+
+static void set_add (UpdateSet *set, GPtrArray *ids, const char *id, gboolean security, const UpdateSet *prev, int *new_security, int *new_other)
+{
+    if (security) set->n_security++;
+
+    set->hashes[ids->len] = hash_id (id);
+    set->fingerprint += set->hashes[ids->len];
+    set->security[ids->len] = security;
+
+    /* an update is new if its hash is not in the previous set */
+    if (prev && (!prev->n_updates || !bsearch (&set->hashes[ids->len], prev->hashes, prev->n_updates, sizeof (guint64), compare_hashes)))
+    {
+        if (security) (*new_security)++;
+        else (*new_other)++;
+    }
+
+    g_ptr_array_add (ids, g_strdup (id));
+}
+
+static UpdateSet *set_end (UpdateSet *set, GPtrArray *ids)
+{
+    set->n_updates = ids->len;
+    g_ptr_array_add (ids, NULL);
+    set->ids = (char **) g_ptr_array_free (ids, FALSE);
+    qsort (set->hashes, set->n_updates, sizeof (guint64), compare_hashes);
+    return set;
+}
+
+/* Filter and classify the packages from a check, rather than building a   */
+/* filtered sack and then walking it again for the counts, hashes and IDs. */
+/* If prev is given, updates which were not in it are counted into         */
+/* new_security and new_other. A NULL sack gives an empty set.             */
+UpdateSet *update_set_new (PkPackageSack *sack, const UpdateSet *prev, int *new_security, int *new_other)
+{
+    UpdateSet *set;
+    PkPackage *pkg;
+    GPtrArray *pkgs, *ids;
+    guint i;
+
+    pkgs = sack ? pk_package_sack_get_array (sack) : g_ptr_array_new ();
+    set = set_begin (pkgs->len, &ids, new_security, new_other);
+    for (i = 0; i < pkgs->len; i++)
+    {
+        pkg = PK_PACKAGE (g_ptr_array_index (pkgs, i));
+        if (!check_filter (pkg, NULL)) continue;
+        set_add (set, ids, pk_package_get_id (pkg), check_is_security (pkg), prev, new_security, new_other);
+    }
+    g_ptr_array_unref (pkgs);
+    return set_end (set, ids);
+}
+
+/* As update_set_new, for updates which have already been filtered and classified */
+UpdateSet *update_set_new_from_ids (const char *const *ids, const guint8 *security, int n_updates, const UpdateSet *prev, int *new_security, int *new_other)
+{
+    UpdateSet *set;
+    GPtrArray *arr;
+    int i;
+
+    set = set_begin (n_updates, &arr, new_security, new_other);
+    for (i = 0; i < n_updates; i++)
+        set_add (set, arr, ids[i], security[i], prev, new_security, new_other);
+    return set_end (set, arr);
+}
+
+/* Append a string to JSON output, quoted and escaped */
+void update_json_string (GString *str, const char *val)
+{
+    g_string_append_c (str, '"');
+    for (; *val; val++)
+    {
+        if (*val == '"' || *val == '\\') g_string_append_printf (str, "\\%c", *val);
+        else if ((guchar) *val < 0x20) g_string_append_printf (str, "\\u%04x", (guchar) *val);
+        else g_string_append_c (str, *val);
+    }
+    g_string_append_c (str, '"');
+}
+
+/* Append the updates as a JSON array - package IDs are "name;version;arch;data" */
+void update_set_append_json (const UpdateSet *set, GString *str)
+{
+    char **fields;
+    int i;
+
+    g_string_append_c (str, '[');
+    for (i = 0; i < set->n_updates; i++)
+    {
+        fields = g_strsplit (set->ids[i], ";", 4);
+        if (i) g_string_append_c (str, ',');
+        g_string_append (str, "{\"id\":");
+        update_json_string (str, set->ids[i]);
+        if (g_strv_length (fields) >= 3)
+        {
+            g_string_append (str, ",\"name\":");
+            update_json_string (str, fields[0]);
+            g_string_append (str, ",\"version\":");
+            update_json_string (str, fields[1]);
+            g_string_append (str, ",\"arch\":");
+            update_json_string (str, fields[2]);
+        }
+        g_string_append_c (str, '}');
+        g_strfreev (fields);
+    }
+    g_string_append_c (str, ']');
+}
+
+/* Split a package ID into name and version without allocating, for the list */
+/* of updates - both are copied into buf, each cut to half of it, with the   */
+/* name first. Returns FALSE if the ID has no version                       */
+gboolean update_id_split (const char *id, char *buf, gsize size, char **version)
+{
+    const char *sep1, *sep2;
+    gsize len;
+
+    sep1 = strchr (id, ';');
+    if (!sep1) return FALSE;
+    sep2 = strchr (sep1 + 1, ';');
+    if (!sep2) sep2 = sep1 + strlen (sep1);
+
+    len = MIN ((gsize) (sep1 - id), size / 2 - 1);
+    memcpy (buf, id, len);
+    buf[len] = 0;
+    *version = buf + len + 1;
+    len = MIN ((gsize) (sep2 - sep1 - 1), size / 2 - 1);
+    memcpy (*version, sep1 + 1, len);
+    (*version)[len] = 0;
+    return TRUE;
+}
+
+UpdateSet *update_set_ref (UpdateSet *set)
+{
+    if (set) g_atomic_int_inc (&set->refs);
+    return set;
+}
+
+void update_set_unref (UpdateSet *set)
+{
+    if (!set || !g_atomic_int_dec_and_test (&set->refs)) return;
+    g_strfreev (set->ids);
+    g_free (set->hashes);
+    g_free (set->security);
+    g_free (set);
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,70 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#ifndef UPDATER_UPDATES_H
+#define UPDATER_UPDATES_H
+
+#include <glib.h>
+
+#define I_KNOW_THE_PACKAGEKIT_GLIB2_API_IS_SUBJECT_TO_CHANGE
+#include <packagekit-glib2/packagekit.h>
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* The filtered result of a check - a set is never modified once built, so */
+/* it can be shared by reference, and each holder drops its own reference  */
+
+typedef struct _UpdateSet
+{
+    gint refs;                      /* Reference count, changed atomically */
+    int n_updates;                  /* Number of pending updates */
+    int n_security;                 /* Number of pending updates which are security fixes */
+    char **ids;                     /* NULL-terminated array of package IDs */
+    guint8 *security;               /* Per ID, non-zero if the update is a security fix */
+    guint64 *hashes;                /* Sorted hashes of the package IDs */
+    guint64 fingerprint;            /* Hash of the set of package IDs */
+} UpdateSet;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+extern UpdateSet *update_set_new (PkPackageSack *sack, const UpdateSet *prev, int *new_security, int *new_other);
+extern UpdateSet *update_set_new_from_ids (const char *const *ids, const guint8 *security, int n_updates, const UpdateSet *prev,
+    int *new_security, int *new_other);
+extern void update_set_append_json (const UpdateSet *set, GString *str);
+extern void update_json_string (GString *str, const char *val);
+extern gboolean update_id_split (const char *id, char *buf, gsize size, char **version);
+extern UpdateSet *update_set_ref (UpdateSet *set);
+extern void update_set_unref (UpdateSet *set);
+
+#endif
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
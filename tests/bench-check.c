@@ -0,0 +1,209 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include "check.h"
+#include "updates.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Client errors from a failed transaction are the PackageKit error code offset by this */
+#define PK_ERROR_OFFSET 0xff
+
+/* Phases of a check as the plugin times them - spawn is the part of a check */
+/* which is neither refresh nor query, so the thread and the main loop hops, */
+/* and total is from starting the check to its result reaching the main loop */
+
+typedef enum
+{
+    BENCH_SPAWN,
+    BENCH_REFRESH,
+    BENCH_QUERY,
+    BENCH_FILTER,
+    BENCH_TOTAL,
+    N_BENCH
+} BenchPhase;
+
+typedef struct
+{
+    int count;
+    gint64 total_us;
+    gint64 min_us;
+    gint64 max_us;
+} BenchStat;
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+static int n_runs = 10;
+static gboolean no_refresh;
+static gboolean isolate;
+static char *expect_error;
+
+static GOptionEntry entries[] =
+{
+    { "runs", 'r', 0, G_OPTION_ARG_INT, &n_runs, "Number of checks to run", "N" },
+    { "no-refresh", 'n', 0, G_OPTION_ARG_NONE, &no_refresh, "Use the package cache as it is, without refreshing it", NULL },
+    { "isolate", 'i', 0, G_OPTION_ARG_NONE, &isolate, "Run the checks in the installed helper process", NULL },
+    { "expect-error", 'e', 0, G_OPTION_ARG_STRING, &expect_error, "Succeed only if every check fails with this PackageKit error", "ERROR" },
+    { NULL }
+};
+
+static const char *bench_names[N_BENCH] = { "spawn", "refresh", "query", "filter", "total" };
+
+static GMainLoop *loop;
+static BenchStat stats[N_BENCH];
+static int n_done;
+static int n_errors;
+static int last_error;
+static int n_updates;
+static int n_security;
+static gint64 check_start_us;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static void stat_add (BenchPhase phase, gint64 us);
+static void start_run (void);
+static void run_done (Replay *rep, gboolean cancelled, gpointer user_data);
+static void print_json (void);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+static void stat_add (BenchPhase phase, gint64 us)
+{
+    BenchStat *st = &stats[phase];
+
+    if (!st->count++ || us < st->min_us) st->min_us = us;
+    st->total_us += us;
+    if (us > st->max_us) st->max_us = us;
+}
+
+static void start_run (void)
+{
+    check_start_us = g_get_monotonic_time ();
+    check_start (!no_refresh, isolate, NULL, 0, run_done, NULL);
+}
+
+/* The same steps as the plugin takes once a check ends - the filter is the */
+/* set of updates being built, with its hashes and security flags          */
+static void run_done (Replay *rep, gboolean cancelled, gpointer)
+{
+    UpdateSet *set;
+    gint64 start, total;
+
+    total = g_get_monotonic_time () - check_start_us;
+    if (cancelled || !rep || rep->refresh_error != REPLAY_OK || rep->query_error != REPLAY_OK)
+    {
+        n_errors++;
+        if (rep) last_error = rep->refresh_error != REPLAY_OK ? rep->refresh_error : rep->query_error;
+    }
+    else
+    {
+        start = g_get_monotonic_time ();
+        set = update_set_new (rep->sack, NULL, NULL, NULL);
+        stat_add (BENCH_FILTER, g_get_monotonic_time () - start);
+        n_updates = set->n_updates;
+        n_security = set->n_security;
+        update_set_unref (set);
+
+        stat_add (BENCH_REFRESH, rep->refresh_us);
+        stat_add (BENCH_QUERY, rep->query_us);
+        stat_add (BENCH_SPAWN, MAX (total - rep->refresh_us - rep->query_us, 0));
+        stat_add (BENCH_TOTAL, total);
+        n_done++;
+    }
+
+    if (n_done + n_errors < n_runs) start_run ();
+    else g_main_loop_quit (loop);
+}
+
+static void print_json (void)
+{
+    GString *str;
+    int i;
+
+    str = g_string_new ("{");
+    g_string_append_printf (str, "\"runs\":%d,\"errors\":%d,\"last_error\":%d,\"updates\":%d,\"security\":%d,\"refresh\":%s,\"phases\":{",
+        n_done, n_errors, last_error, n_updates, n_security, no_refresh ? "false" : "true");
+    for (i = 0; i < N_BENCH; i++)
+    {
+        if (i) g_string_append_c (str, ',');
+        g_string_append_printf (str, "\"%s\":{\"mean_us\":%" G_GINT64_FORMAT ",\"min_us\":%" G_GINT64_FORMAT ",\"max_us\":%" G_GINT64_FORMAT "}",
+            bench_names[i], stats[i].count ? stats[i].total_us / stats[i].count : 0, stats[i].min_us, stats[i].max_us);
+    }
+    g_string_append (str, "}}\n");
+    fputs (str->str, stdout);
+    g_string_free (str, TRUE);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Entry point                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Runs checks through the same asynchronous pipeline as the panel plugins, */
+/* one after another, against whichever PackageKit is on the system bus -   */
+/* normally the mock - and prints the timing of each phase as JSON          */
+
+int main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError *error = NULL;
+
+    context = g_option_context_new (NULL);
+    g_option_context_set_summary (context, "Time the phases of the update check pipeline.");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "bench-check: %s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return 1;
+    }
+    g_option_context_free (context);
+
+    loop = g_main_loop_new (NULL, FALSE);
+    start_run ();
+    g_main_loop_run (loop);
+    g_main_loop_unref (loop);
+
+    print_json ();
+    if (expect_error) return n_done || last_error != PK_ERROR_OFFSET + pk_error_enum_from_string (expect_error);
+    return n_errors ? 1 : 0;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
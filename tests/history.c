@@ -0,0 +1,321 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "history.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+#define HEADER_SIZE 16
+#define RECORD_SIZE 64
+
+/* Must match history.c */
+#define MAX_RECORDS 4096
+#define KEEP_RECORDS 2048
+
+/* Processes appending at once, and records each - enough between them to */
+/* compact the file part of the way through                               */
+#define N_WRITERS 4
+#define WRITER_RECORDS 1500
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+static char *path;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static gboolean expect (gboolean cond, const char *what);
+static void make_record (HistoryRecord *rec, gint32 status);
+static gboolean load (char **buf, gsize *len);
+static gboolean layout (void);
+static gboolean torn (void);
+static gboolean version (void);
+static gboolean compact (void);
+static gboolean concurrent (void);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+static gboolean expect (gboolean cond, const char *what)
+{
+    if (!cond) printf ("FAIL: %s\n", what);
+    return cond;
+}
+
+static void make_record (HistoryRecord *rec, gint32 status)
+{
+    int i;
+
+    memset (rec, 0, sizeof (HistoryRecord));
+    rec->type = HISTORY_CHECK;
+    rec->n_updates = 1234;
+    rec->n_security = 56;
+    rec->start = G_GINT64_CONSTANT (1700000000000000) + status;
+    rec->end = rec->start + 2500000;
+    rec->fingerprint = G_GUINT64_CONSTANT (0x0123456789abcdef);
+    for (i = 0; i < HISTORY_MAX_PHASES; i++) rec->phase_ms[i] = 100 * (i + 1);
+    rec->status = status;
+}
+
+static gboolean load (char **buf, gsize *len)
+{
+    return g_file_get_contents (path, buf, len, NULL);
+}
+
+/* The bytes of the file, as another program reading it would see them */
+static gboolean layout (void)
+{
+    HistoryRecord rec;
+    HistoryView view;
+    guint16 u16;
+    guint32 u32;
+    gint32 s32;
+    gint64 s64;
+    guint64 u64;
+    gsize len;
+    char *buf, *r;
+    int i;
+    gboolean ok = TRUE;
+
+    g_unlink (path);
+    for (i = 0; i < 3; i++)
+    {
+        make_record (&rec, i);
+        if (i == 1)
+        {
+            rec.type = HISTORY_INSTALL;
+            rec.error = 1;
+            rec.status = -5;
+        }
+        history_append (&rec);
+    }
+
+    if (!expect (load (&buf, &len), "the file was not written")) return FALSE;
+    ok &= expect (len == HEADER_SIZE + 3 * RECORD_SIZE, "the file is not a header and three records");
+    ok &= expect (!memcmp (buf, HISTORY_MAGIC, 4), "the magic number is wrong");
+    memcpy (&u16, buf + 4, 2);
+    ok &= expect (u16 == HISTORY_VERSION, "the version is wrong");
+    memcpy (&u16, buf + 6, 2);
+    ok &= expect (u16 == RECORD_SIZE, "the record size is wrong");
+
+    /* the second record, field by field */
+    r = buf + HEADER_SIZE + RECORD_SIZE;
+    ok &= expect (r[0] == HISTORY_INSTALL, "the type is not at offset 0");
+    ok &= expect (r[1] == 1, "the error flag is not at offset 1");
+    memcpy (&u16, r + 2, 2);
+    ok &= expect (u16 == 1234, "the update count is not at offset 2");
+    memcpy (&u16, r + 4, 2);
+    ok &= expect (u16 == 56, "the security update count is not at offset 4");
+    memcpy (&s64, r + 8, 8);
+    ok &= expect (s64 == G_GINT64_CONSTANT (1700000000000001), "the start time is not at offset 8");
+    memcpy (&s64, r + 16, 8);
+    ok &= expect (s64 == G_GINT64_CONSTANT (1700000002500001), "the end time is not at offset 16");
+    memcpy (&u64, r + 24, 8);
+    ok &= expect (u64 == G_GUINT64_CONSTANT (0x0123456789abcdef), "the fingerprint is not at offset 24");
+    for (i = 0; i < HISTORY_MAX_PHASES; i++)
+    {
+        memcpy (&u32, r + 32 + 4 * i, 4);
+        ok &= expect (u32 == (guint32) (100 * (i + 1)), "the phase times are not at offset 32");
+    }
+    memcpy (&s32, r + 56, 4);
+    ok &= expect (s32 == -5, "the status is not at offset 56");
+    g_free (buf);
+
+    ok &= expect (history_open (&view), "the file could not be opened");
+    ok &= expect (view.n_records == 3, "the file did not have three records");
+    make_record (&rec, 2);
+    if (view.n_records == 3) ok &= expect (!memcmp (&view.records[2], &rec, sizeof (HistoryRecord)), "the last record did not read back");
+    history_close (&view);
+    return ok;
+}
+
+/* Part of a record left by a writer which was killed is dropped */
+static gboolean torn (void)
+{
+    HistoryRecord rec;
+    HistoryView view;
+    gsize len;
+    char *buf, *tail;
+    gboolean ok = TRUE;
+
+    if (!expect (load (&buf, &len), "the file was not written")) return FALSE;
+    tail = g_malloc0 (len + 10);
+    memcpy (tail, buf, len);
+    memset (tail + len, 0xff, 10);
+    g_file_set_contents (path, tail, len + 10, NULL);
+    g_free (tail);
+    g_free (buf);
+
+    make_record (&rec, 3);
+    history_append (&rec);
+
+    ok &= expect (history_open (&view), "the file could not be opened");
+    ok &= expect (view.n_records == 4, "the partial record was not dropped");
+    if (view.n_records == 4) ok &= expect (!memcmp (&view.records[3], &rec, sizeof (HistoryRecord)), "the record after it did not read back");
+    history_close (&view);
+    return ok;
+}
+
+/* A file from another version is started again */
+static gboolean version (void)
+{
+    HistoryRecord rec;
+    HistoryView view;
+    gsize len;
+    char *buf;
+    guint16 v = HISTORY_VERSION + 1;
+    gboolean ok = TRUE;
+
+    if (!expect (load (&buf, &len), "the file was not written")) return FALSE;
+    memcpy (buf + 4, &v, 2);
+    g_file_set_contents (path, buf, len, NULL);
+    g_free (buf);
+
+    ok &= expect (!history_open (&view), "a file from another version was read");
+
+    make_record (&rec, 4);
+    history_append (&rec);
+    ok &= expect (history_open (&view), "the file could not be opened");
+    ok &= expect (view.n_records == 1, "the file was not started again");
+    history_close (&view);
+    return ok;
+}
+
+/* Once the file is full it keeps only the newest records, in order */
+static gboolean compact (void)
+{
+    HistoryRecord rec;
+    HistoryView view;
+    int i;
+    gboolean ok = TRUE;
+
+    g_unlink (path);
+    for (i = 0; i <= MAX_RECORDS; i++)
+    {
+        make_record (&rec, i);
+        history_append (&rec);
+    }
+
+    ok &= expect (history_open (&view), "the file could not be opened");
+    ok &= expect (view.n_records == KEEP_RECORDS, "the file was not compacted");
+    for (i = 0; i < view.n_records; i++)
+        if (view.records[i].status != MAX_RECORDS - view.n_records + 1 + i) break;
+    ok &= expect (i == view.n_records, "the newest records were not kept in order");
+    history_close (&view);
+    return ok;
+}
+
+/* Processes appending at the same time, across a compaction - no record may */
+/* be lost or torn, so the count is exactly as for appends one after another */
+static gboolean concurrent (void)
+{
+    HistoryRecord rec;
+    HistoryView view;
+    pid_t pids[N_WRITERS];
+    gint32 last[N_WRITERS];
+    int i, j, status, writer, total, expected;
+    gboolean ok = TRUE;
+
+    g_unlink (path);
+    for (i = 0; i < N_WRITERS; i++)
+    {
+        pids[i] = fork ();
+        if (pids[i] == 0)
+        {
+            for (j = 0; j < WRITER_RECORDS; j++)
+            {
+                make_record (&rec, i << 16 | j);
+                history_append (&rec);
+            }
+            _exit (0);
+        }
+    }
+    for (i = 0; i < N_WRITERS; i++)
+    {
+        ok &= expect (pids[i] > 0 && waitpid (pids[i], &status, 0) == pids[i] && WIFEXITED (status) && !WEXITSTATUS (status),
+            "a writer failed");
+        last[i] = -1;
+    }
+
+    /* appends one after another reach MAX_RECORDS + 1, keep KEEP_RECORDS, */
+    /* and then carry on until they are all done                          */
+    total = N_WRITERS * WRITER_RECORDS;
+    expected = total > MAX_RECORDS ? KEEP_RECORDS + total - MAX_RECORDS - 1 : total;
+
+    ok &= expect (history_open (&view), "the file could not be opened");
+    ok &= expect (view.n_records == expected, "records were lost");
+    for (i = 0; i < view.n_records; i++)
+    {
+        writer = view.records[i].status >> 16;
+        if (!expect (writer >= 0 && writer < N_WRITERS && view.records[i].type == HISTORY_CHECK, "a record was torn")) break;
+        if (!expect ((view.records[i].status & 0xffff) > last[writer], "a writer's records are out of order")) break;
+        last[writer] = view.records[i].status & 0xffff;
+    }
+    printf ("%d writers appended %d records, %d kept\n", N_WRITERS, total, view.n_records);
+    history_close (&view);
+    return ok;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Entry point                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Tests the history file in the cache directory - set XDG_CACHE_HOME to */
+/* keep it away from the user's own                                      */
+
+int main (void)
+{
+    gboolean ok = TRUE;
+
+    path = g_build_filename (g_get_user_cache_dir (), "lxplug-updater", "history", NULL);
+
+    ok &= layout ();
+    ok &= torn ();
+    ok &= version ();
+    ok &= compact ();
+    ok &= concurrent ();
+
+    g_free (path);
+    return ok ? 0 : 1;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
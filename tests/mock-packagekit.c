@@ -0,0 +1,432 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gio/gio.h>
+
+#define I_KNOW_THE_PACKAGEKIT_GLIB2_API_IS_SUBJECT_TO_CHANGE
+#include <packagekit-glib2/packagekit.h>
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Stand-in for packagekitd, implementing just the parts of its D-Bus API   */
+/* which the check uses - a refresh, and a query which returns a synthetic */
+/* set of updates. It is meant to be run on a private bus which the client  */
+/* is pointed at as its system bus, with DBUS_SYSTEM_BUS_ADDRESS             */
+
+#define PK_NAME "org.freedesktop.PackageKit"
+#define PK_PATH "/org/freedesktop/PackageKit"
+#define PK_INTERFACE "org.freedesktop.PackageKit"
+#define PK_TRANSACTION_INTERFACE "org.freedesktop.PackageKit.Transaction"
+
+typedef struct
+{
+    GDBusConnection *conn;
+    char *path;                     /* Object path of the transaction */
+    guint reg_id;                   /* Object registration ID */
+    PkRoleEnum role;                /* Method called, or unknown before one is */
+    PkStatusEnum status;
+    guint timer;                    /* Timer ID for the end of the call in progress */
+    gint64 start;                   /* Monotonic time at which the call started */
+} Transaction;
+
+static const char daemon_xml[] =
+    "<node>"
+    "  <interface name='" PK_INTERFACE "'>"
+    "    <method name='CreateTransaction'>"
+    "      <arg type='o' name='object_path' direction='out'/>"
+    "    </method>"
+    "    <method name='GetTimeSinceAction'>"
+    "      <arg type='u' name='role' direction='in'/>"
+    "      <arg type='u' name='seconds' direction='out'/>"
+    "    </method>"
+    "    <method name='GetTransactionList'>"
+    "      <arg type='as' name='transactions' direction='out'/>"
+    "    </method>"
+    "    <property type='u' name='VersionMajor' access='read'/>"
+    "    <property type='u' name='VersionMinor' access='read'/>"
+    "    <property type='u' name='VersionMicro' access='read'/>"
+    "    <property type='s' name='BackendName' access='read'/>"
+    "    <property type='s' name='BackendDescription' access='read'/>"
+    "    <property type='s' name='BackendAuthor' access='read'/>"
+    "    <property type='t' name='Roles' access='read'/>"
+    "    <property type='t' name='Groups' access='read'/>"
+    "    <property type='t' name='Filters' access='read'/>"
+    "    <property type='as' name='MimeTypes' access='read'/>"
+    "    <property type='b' name='Locked' access='read'/>"
+    "    <property type='u' name='NetworkState' access='read'/>"
+    "    <property type='s' name='DistroId' access='read'/>"
+    "  </interface>"
+    "</node>";
+
+static const char transaction_xml[] =
+    "<node>"
+    "  <interface name='" PK_TRANSACTION_INTERFACE "'>"
+    "    <method name='SetHints'>"
+    "      <arg type='as' name='hints' direction='in'/>"
+    "    </method>"
+    "    <method name='RefreshCache'>"
+    "      <arg type='b' name='force' direction='in'/>"
+    "    </method>"
+    "    <method name='GetUpdates'>"
+    "      <arg type='t' name='filter' direction='in'/>"
+    "    </method>"
+    "    <method name='Cancel'/>"
+    "    <signal name='Package'>"
+    "      <arg type='u' name='info'/>"
+    "      <arg type='s' name='package_id'/>"
+    "      <arg type='s' name='summary'/>"
+    "    </signal>"
+    "    <signal name='ErrorCode'>"
+    "      <arg type='u' name='code'/>"
+    "      <arg type='s' name='details'/>"
+    "    </signal>"
+    "    <signal name='Finished'>"
+    "      <arg type='u' name='exit'/>"
+    "      <arg type='u' name='runtime'/>"
+    "    </signal>"
+    "    <signal name='Destroy'/>"
+    "    <property type='u' name='Role' access='read'/>"
+    "    <property type='u' name='Status' access='read'/>"
+    "    <property type='s' name='LastPackage' access='read'/>"
+    "    <property type='u' name='Uid' access='read'/>"
+    "    <property type='u' name='Percentage' access='read'/>"
+    "    <property type='b' name='AllowCancel' access='read'/>"
+    "    <property type='b' name='CallerActive' access='read'/>"
+    "    <property type='u' name='ElapsedTime' access='read'/>"
+    "    <property type='u' name='RemainingTime' access='read'/>"
+    "    <property type='u' name='Speed' access='read'/>"
+    "    <property type='t' name='DownloadSizeRemaining' access='read'/>"
+    "    <property type='t' name='TransactionFlags' access='read'/>"
+    "  </interface>"
+    "</node>";
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+static int refresh_ms = 500;
+static int query_ms = 200;
+static int n_updates = 100;
+static int security_every = 10;
+static char *refresh_error;
+static char *query_error;
+static char *arch = "arm64";
+
+static GOptionEntry entries[] =
+{
+    { "refresh-ms", 0, 0, G_OPTION_ARG_INT, &refresh_ms, "Time taken to refresh the cache", "MS" },
+    { "query-ms", 0, 0, G_OPTION_ARG_INT, &query_ms, "Time taken to get the updates", "MS" },
+    { "updates", 'u', 0, G_OPTION_ARG_INT, &n_updates, "Number of updates returned", "N" },
+    { "security-every", 0, 0, G_OPTION_ARG_INT, &security_every, "Make every Nth update a security update, or none if 0", "N" },
+    { "refresh-error", 0, 0, G_OPTION_ARG_STRING, &refresh_error, "Fail the refresh with this PackageKit error, e.g. no-network", "ERROR" },
+    { "query-error", 0, 0, G_OPTION_ARG_STRING, &query_error, "Fail the query with this PackageKit error", "ERROR" },
+    { "arch", 0, 0, G_OPTION_ARG_STRING, &arch, "Architecture of the updates", "ARCH" },
+    { NULL }
+};
+
+static GDBusNodeInfo *daemon_info;
+static GDBusNodeInfo *transaction_info;
+static guint n_transactions;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static GVariant *daemon_property (GDBusConnection *conn, const gchar *sender, const gchar *path, const gchar *iface,
+    const gchar *name, GError **error, gpointer user_data);
+static void daemon_method (GDBusConnection *conn, const gchar *sender, const gchar *path, const gchar *iface,
+    const gchar *method, GVariant *params, GDBusMethodInvocation *invocation, gpointer user_data);
+static GVariant *transaction_property (GDBusConnection *conn, const gchar *sender, const gchar *path, const gchar *iface,
+    const gchar *name, GError **error, gpointer user_data);
+static void transaction_method (GDBusConnection *conn, const gchar *sender, const gchar *path, const gchar *iface,
+    const gchar *method, GVariant *params, GDBusMethodInvocation *invocation, gpointer user_data);
+static void transaction_emit (Transaction *tr, const char *signal, GVariant *params);
+static void transaction_finish (Transaction *tr, PkExitEnum exit_code, const char *error);
+static gboolean transaction_done (gpointer data);
+static gboolean transaction_free (gpointer data);
+static void bus_acquired (GDBusConnection *conn, const gchar *name, gpointer user_data);
+static void name_lost (GDBusConnection *conn, const gchar *name, gpointer user_data);
+
+static const GDBusInterfaceVTable daemon_vtable = { daemon_method, daemon_property, NULL };
+static const GDBusInterfaceVTable transaction_vtable = { transaction_method, transaction_property, NULL };
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Daemon object                                                              */
+/*----------------------------------------------------------------------------*/
+
+static GVariant *daemon_property (GDBusConnection *, const gchar *, const gchar *, const gchar *,
+    const gchar *name, GError **error, gpointer)
+{
+    if (!strcmp (name, "VersionMajor")) return g_variant_new_uint32 (1);
+    if (!strcmp (name, "VersionMinor")) return g_variant_new_uint32 (2);
+    if (!strcmp (name, "VersionMicro")) return g_variant_new_uint32 (6);
+    if (!strcmp (name, "BackendName")) return g_variant_new_string ("mock");
+    if (!strcmp (name, "BackendDescription")) return g_variant_new_string ("Mock backend for testing");
+    if (!strcmp (name, "BackendAuthor")) return g_variant_new_string ("");
+    if (!strcmp (name, "Roles"))
+        return g_variant_new_uint64 (pk_bitfield_from_enums (PK_ROLE_ENUM_REFRESH_CACHE, PK_ROLE_ENUM_GET_UPDATES, -1));
+    if (!strcmp (name, "Groups")) return g_variant_new_uint64 (0);
+    if (!strcmp (name, "Filters")) return g_variant_new_uint64 (pk_bitfield_value (PK_FILTER_ENUM_NONE));
+    if (!strcmp (name, "MimeTypes")) return g_variant_new_strv (NULL, 0);
+    if (!strcmp (name, "Locked")) return g_variant_new_boolean (FALSE);
+    if (!strcmp (name, "NetworkState")) return g_variant_new_uint32 (PK_NETWORK_ENUM_ONLINE);
+    if (!strcmp (name, "DistroId")) return g_variant_new_string ("debian;12;arm64");
+
+    g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property %s", name);
+    return NULL;
+}
+
+static void daemon_method (GDBusConnection *conn, const gchar *, const gchar *, const gchar *,
+    const gchar *method, GVariant *, GDBusMethodInvocation *invocation, gpointer)
+{
+    Transaction *tr;
+    GError *error = NULL;
+
+    if (!strcmp (method, "CreateTransaction"))
+    {
+        tr = g_new0 (Transaction, 1);
+        tr->conn = conn;
+        tr->path = g_strdup_printf ("/%u_mock", ++n_transactions);
+        tr->role = PK_ROLE_ENUM_UNKNOWN;
+        tr->status = PK_STATUS_ENUM_WAIT;
+        tr->reg_id = g_dbus_connection_register_object (conn, tr->path, transaction_info->interfaces[0], &transaction_vtable, tr, NULL, &error);
+        if (!tr->reg_id)
+        {
+            g_dbus_method_invocation_return_gerror (invocation, error);
+            g_error_free (error);
+            g_free (tr->path);
+            g_free (tr);
+            return;
+        }
+        g_dbus_method_invocation_return_value (invocation, g_variant_new ("(o)", tr->path));
+    }
+    else if (!strcmp (method, "GetTimeSinceAction"))
+        g_dbus_method_invocation_return_value (invocation, g_variant_new ("(u)", 0));
+    else if (!strcmp (method, "GetTransactionList"))
+        g_dbus_method_invocation_return_value (invocation, g_variant_new ("(@as)", g_variant_new_strv (NULL, 0)));
+    else g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD, "Unknown method %s", method);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Transaction objects                                                        */
+/*----------------------------------------------------------------------------*/
+
+static GVariant *transaction_property (GDBusConnection *, const gchar *, const gchar *, const gchar *,
+    const gchar *name, GError **error, gpointer user_data)
+{
+    Transaction *tr = (Transaction *) user_data;
+
+    if (!strcmp (name, "Role")) return g_variant_new_uint32 (tr->role);
+    if (!strcmp (name, "Status")) return g_variant_new_uint32 (tr->status);
+    if (!strcmp (name, "LastPackage")) return g_variant_new_string ("");
+    if (!strcmp (name, "Uid")) return g_variant_new_uint32 (0);
+    if (!strcmp (name, "Percentage")) return g_variant_new_uint32 (101);
+    if (!strcmp (name, "AllowCancel")) return g_variant_new_boolean (TRUE);
+    if (!strcmp (name, "CallerActive")) return g_variant_new_boolean (TRUE);
+    if (!strcmp (name, "ElapsedTime")) return g_variant_new_uint32 (0);
+    if (!strcmp (name, "RemainingTime")) return g_variant_new_uint32 (0);
+    if (!strcmp (name, "Speed")) return g_variant_new_uint32 (0);
+    if (!strcmp (name, "DownloadSizeRemaining")) return g_variant_new_uint64 (0);
+    if (!strcmp (name, "TransactionFlags")) return g_variant_new_uint64 (0);
+
+    g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property %s", name);
+    return NULL;
+}
+
+/* Each call returns at once, and its results follow as signals once the */
+/* configured latency has passed, as they would from packagekitd          */
+static void transaction_method (GDBusConnection *, const gchar *, const gchar *, const gchar *,
+    const gchar *method, GVariant *, GDBusMethodInvocation *invocation, gpointer user_data)
+{
+    Transaction *tr = (Transaction *) user_data;
+
+    if (!strcmp (method, "SetHints"))
+    {
+        g_dbus_method_invocation_return_value (invocation, NULL);
+        return;
+    }
+
+    if (!strcmp (method, "Cancel"))
+    {
+        g_dbus_method_invocation_return_value (invocation, NULL);
+        if (!tr->timer) return;
+        g_source_remove (tr->timer);
+        tr->timer = 0;
+        transaction_emit (tr, "ErrorCode", g_variant_new ("(us)", PK_ERROR_ENUM_TRANSACTION_CANCELLED, "Cancelled"));
+        transaction_finish (tr, PK_EXIT_ENUM_CANCELLED, NULL);
+        return;
+    }
+
+    if (tr->role != PK_ROLE_ENUM_UNKNOWN)
+    {
+        g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR, G_DBUS_ERROR_FAILED, "Transaction already used");
+        return;
+    }
+
+    if (!strcmp (method, "RefreshCache"))
+    {
+        tr->role = PK_ROLE_ENUM_REFRESH_CACHE;
+        tr->status = PK_STATUS_ENUM_REFRESH_CACHE;
+        tr->timer = g_timeout_add (refresh_ms, transaction_done, tr);
+    }
+    else if (!strcmp (method, "GetUpdates"))
+    {
+        tr->role = PK_ROLE_ENUM_GET_UPDATES;
+        tr->status = PK_STATUS_ENUM_QUERY;
+        tr->timer = g_timeout_add (query_ms, transaction_done, tr);
+    }
+    else
+    {
+        g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD, "Unknown method %s", method);
+        return;
+    }
+
+    tr->start = g_get_monotonic_time ();
+    g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static void transaction_emit (Transaction *tr, const char *signal, GVariant *params)
+{
+    g_dbus_connection_emit_signal (tr->conn, NULL, tr->path, PK_TRANSACTION_INTERFACE, signal, params, NULL);
+}
+
+/* The object stays exported until the client has had the Destroy signal */
+static void transaction_finish (Transaction *tr, PkExitEnum exit_code, const char *error)
+{
+    if (error)
+    {
+        transaction_emit (tr, "ErrorCode", g_variant_new ("(us)", pk_error_enum_from_string (error), "Injected error"));
+        exit_code = PK_EXIT_ENUM_FAILED;
+    }
+    tr->status = PK_STATUS_ENUM_FINISHED;
+    transaction_emit (tr, "Finished", g_variant_new ("(uu)", exit_code, (guint) ((g_get_monotonic_time () - tr->start) / 1000)));
+    transaction_emit (tr, "Destroy", NULL);
+    g_timeout_add_seconds (1, transaction_free, tr);
+}
+
+static gboolean transaction_done (gpointer data)
+{
+    Transaction *tr = (Transaction *) data;
+    char *id;
+    int i;
+
+    tr->timer = 0;
+    if (tr->role == PK_ROLE_ENUM_REFRESH_CACHE)
+    {
+        transaction_finish (tr, PK_EXIT_ENUM_SUCCESS, refresh_error);
+        return G_SOURCE_REMOVE;
+    }
+
+    if (!query_error)
+    {
+        for (i = 0; i < n_updates; i++)
+        {
+            id = g_strdup_printf ("mock-package-%05d;1.0.%d-1;%s;debian-security", i, i, arch);
+            transaction_emit (tr, "Package", g_variant_new ("(uss)",
+                security_every && !(i % security_every) ? PK_INFO_ENUM_SECURITY : PK_INFO_ENUM_NORMAL, id, "Mock package"));
+            g_free (id);
+        }
+    }
+    transaction_finish (tr, PK_EXIT_ENUM_SUCCESS, query_error);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean transaction_free (gpointer data)
+{
+    Transaction *tr = (Transaction *) data;
+
+    g_dbus_connection_unregister_object (tr->conn, tr->reg_id);
+    g_free (tr->path);
+    g_free (tr);
+    return G_SOURCE_REMOVE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Bus name                                                                   */
+/*----------------------------------------------------------------------------*/
+
+static void bus_acquired (GDBusConnection *conn, const gchar *, gpointer)
+{
+    GError *error = NULL;
+
+    if (!g_dbus_connection_register_object (conn, PK_PATH, daemon_info->interfaces[0], &daemon_vtable, NULL, NULL, &error))
+    {
+        fprintf (stderr, "mock-packagekit: %s\n", error->message);
+        exit (1);
+    }
+}
+
+static void name_lost (GDBusConnection *, const gchar *, gpointer)
+{
+    fprintf (stderr, "mock-packagekit: unable to own " PK_NAME "\n");
+    exit (1);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Entry point                                                                */
+/*----------------------------------------------------------------------------*/
+
+int main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    GMainLoop *loop;
+
+    context = g_option_context_new (NULL);
+    g_option_context_set_summary (context, "Mock PackageKit daemon, owning " PK_NAME " on the system bus.");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "mock-packagekit: %s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return 1;
+    }
+    g_option_context_free (context);
+
+    daemon_info = g_dbus_node_info_new_for_xml (daemon_xml, NULL);
+    transaction_info = g_dbus_node_info_new_for_xml (transaction_xml, NULL);
+
+    g_bus_own_name (G_BUS_TYPE_SYSTEM, PK_NAME, G_BUS_NAME_OWNER_FLAGS_NONE, bus_acquired, NULL, name_lost, NULL, NULL);
+
+    loop = g_main_loop_new (NULL, FALSE);
+    g_main_loop_run (loop);
+    return 0;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,72 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include "lxutils.h"
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Sequence number of the notification being shown, or 0 */
+static unsigned int notify_shown;
+static unsigned int notify_last;
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+/* Notifications are only counted - the plugin must clear the one shown */
+/* before it shows another                                               */
+unsigned int test_notify (const char *)
+{
+    if (notify_shown) g_warning ("notification %u was not cleared", notify_shown);
+    notify_shown = ++notify_last;
+    return notify_shown;
+}
+
+void lxpanel_notify_clear (unsigned int seq)
+{
+    if (seq == notify_shown) notify_shown = 0;
+}
+
+void test_set_taskbar_icon (GtkWidget *image, const char *icon)
+{
+    gtk_image_set_from_icon_name (GTK_IMAGE (image), icon, GTK_ICON_SIZE_LARGE_TOOLBAR);
+}
+
+/* There is no panel to place the menu against, so it is left unshown */
+void wrap_show_menu (GtkWidget *, GtkWidget *)
+{
+}
+
+GtkGesture *add_long_press (GtkWidget *, GCallback, gpointer)
+{
+    return NULL;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,60 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+/* Stands in for wf-panel-pi's lxutils.h, so that the plugin can be built */
+/* into a test program with no panel - only what updater.c uses is here   */
+
+#ifndef UPDATER_TEST_LXUTILS_H
+#define UPDATER_TEST_LXUTILS_H
+
+#include <gtk/gtk.h>
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* A test has no long press to tell apart from a click */
+#define CHECK_LONGPRESS
+
+/* The panel and plugin arguments are only used by the panel's own versions */
+#define lxpanel_notify(panel,msg) test_notify (msg)
+#define wrap_set_taskbar_icon(plugin,image,icon) test_set_taskbar_icon (image, icon)
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+extern unsigned int test_notify (const char *msg);
+extern void lxpanel_notify_clear (unsigned int seq);
+extern void test_set_taskbar_icon (GtkWidget *image, const char *icon);
+extern void wrap_show_menu (GtkWidget *plugin, GtkWidget *menu);
+extern GtkGesture *add_long_press (GtkWidget *widget, GCallback cb, gpointer data);
+
+#endif
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,228 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "backend.h"
+#include "clock.h"
+#include "shared.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Longest wait for a check, or for a result to reach the other panel */
+#define WAIT_US (10 * G_USEC_PER_SEC)
+
+#define HOUR_US (3600 * (gint64) G_USEC_PER_SEC)
+
+typedef struct
+{
+    const char *name;
+    Backend *be;
+    guint n_changed;                /* Number of times the state or set of updates has changed */
+} Panel;
+
+typedef gboolean (*WaitFunc) (void);
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+static Panel panels[2] = { { "a", NULL, 0 }, { "b", NULL, 0 } };
+
+/* Panel waiting for another's result, and its change count when it started */
+static Panel *waiting;
+static guint waiting_changed;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static void changed (gpointer user_data);
+static gboolean idle (void);
+static gboolean delivered (void);
+static gboolean wait_for (WaitFunc func);
+static gboolean expect (gboolean cond, const char *what);
+static gboolean share (Panel *lead, Panel *other);
+static void ignore (const SharedResult *res, gpointer user_data);
+static int publish (void);
+static gboolean freshness (const char *self);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+static void changed (gpointer user_data)
+{
+    ((Panel *) user_data)->n_changed++;
+}
+
+static gboolean idle (void)
+{
+    return !backend_checking (panels[0].be) && !backend_checking (panels[1].be);
+}
+
+/* Run the main loop until func returns TRUE, or WAIT_US has passed */
+static gboolean wait_for (WaitFunc func)
+{
+    gint64 deadline = g_get_monotonic_time () + WAIT_US;
+
+    while (!func ())
+    {
+        if (g_get_monotonic_time () >= deadline) return FALSE;
+        if (!g_main_context_iteration (NULL, FALSE)) g_usleep (1000);
+    }
+    return TRUE;
+}
+
+static gboolean expect (gboolean cond, const char *what)
+{
+    if (!cond) printf ("FAIL: %s\n", what);
+    return cond;
+}
+
+static gboolean delivered (void)
+{
+    return waiting->n_changed > waiting_changed;
+}
+
+/* One panel checks, and the other must wait for it rather than check too, */
+/* then take the result it publishes without checking itself               */
+static gboolean share (Panel *lead, Panel *other)
+{
+    guint lead_checks, other_checks, n;
+    gboolean ok = TRUE;
+
+    backend_get_counts (lead->be, &lead_checks, NULL);
+    backend_get_counts (other->be, &other_checks, NULL);
+    waiting = other;
+    waiting_changed = other->n_changed;
+
+    backend_check (lead->be, FALSE);
+    ok &= expect (backend_checking (lead->be), "the first panel did not start a check");
+    backend_check (other->be, FALSE);
+    ok &= expect (!backend_checking (other->be), "the second panel checked while the first held the lock");
+
+    ok &= expect (wait_for (idle), "the check did not end");
+    backend_get_counts (lead->be, &n, NULL);
+    ok &= expect (n == lead_checks + 1, "the first panel did not complete its check");
+    ok &= expect (backend_get_state (lead->be) == UPD_STATE_UPDATES, "the check found no updates");
+
+    ok &= expect (wait_for (delivered), "the result did not reach the second panel");
+    ok &= expect (backend_get_updates (other->be)->fingerprint == backend_get_updates (lead->be)->fingerprint,
+        "the second panel has a different set of updates");
+    ok &= expect (backend_get_state (other->be) == UPD_STATE_UPDATES, "the second panel is not showing the updates");
+    backend_get_counts (other->be, &n, NULL);
+    ok &= expect (n == other_checks, "the second panel ran a check of its own");
+
+    printf ("%s checked, %s took %d updates\n", lead->name, other->name, backend_get_updates (other->be)->n_updates);
+    return ok;
+}
+
+static void ignore (const SharedResult *, gpointer)
+{
+}
+
+/* Run as a separate process, to publish a result as another panel would */
+static int publish (void)
+{
+    Shared *sh = shared_new (ignore, NULL);
+    UpdateSet *set = update_set_new (NULL, NULL, NULL, NULL);
+    gboolean ok = shared_lead (sh);
+
+    if (ok) shared_publish (sh, set, clock_real ());
+    shared_release (sh);
+    update_set_unref (set);
+    shared_free (sh);
+    return ok ? 0 : 1;
+}
+
+/* A timed check is only skipped for a recent result from another panel - */
+/* a panel's own result, written just after its timer was armed, is       */
+/* always less than an interval old when the timer next fires             */
+static gboolean freshness (const char *self)
+{
+    Shared *sh = shared_new (ignore, NULL);
+    UpdateSet *set = update_set_new (NULL, NULL, NULL, NULL);
+    char *argv[3] = { (char *) self, "--publish", NULL };
+    gint status;
+    gboolean ok = TRUE;
+
+    ok &= expect (shared_lead (sh), "the leader lock was still held after the checks ended");
+    shared_publish (sh, set, clock_real ());
+    shared_release (sh);
+    ok &= expect (!shared_read (sh, HOUR_US), "a panel's own result counted as a fresh result");
+
+    ok &= expect (g_spawn_sync (NULL, argv, NULL, G_SPAWN_DEFAULT, NULL, NULL, NULL, NULL, &status, NULL)
+        && g_spawn_check_wait_status (status, NULL), "the other process did not publish a result");
+    ok &= expect (shared_read (sh, HOUR_US), "a recent result from another process did not count as fresh");
+    ok &= expect (!shared_read (sh, 1), "an old result from another process counted as fresh");
+
+    update_set_unref (set);
+    shared_free (sh);
+    return ok;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Entry point                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Runs two backends, as two panels would be, against the same runtime    */
+/* directory and whichever PackageKit is on the system bus - normally the */
+/* mock. Each in turn checks while the other waits for its result, so the */
+/* leader lock must be released after each check, and only once the      */
+/* result has been published. Then a result from this process and one    */
+/* from another are each tested for whether they replace a timed check   */
+
+int main (int argc, char *argv[])
+{
+    static const BackendFuncs funcs = { changed, NULL, NULL };
+    gboolean ok = TRUE;
+    int i;
+
+    if (argc > 1 && !strcmp (argv[1], "--publish")) return publish ();
+
+    for (i = 0; i < 2; i++) panels[i].be = backend_new (&funcs, &panels[i]);
+
+    /* let the startup checks, if there is a network to run them, finish */
+    while (g_main_context_iteration (NULL, FALSE));
+    ok &= expect (wait_for (idle), "the startup checks did not end");
+
+    ok &= share (&panels[0], &panels[1]);
+    ok &= share (&panels[1], &panels[0]);
+    ok &= freshness (argv[0]);
+
+    for (i = 0; i < 2; i++) backend_free (panels[i].be);
+    return ok ? 0 : 1;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,172 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include "backend.h"
+#include "clock.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+#define HOUR_US (3600 * (gint64) G_USEC_PER_SEC)
+#define DAY_US (24 * HOUR_US)
+
+/* A year of scheduling, in periods with different check intervals */
+typedef struct
+{
+    int interval;                   /* Hours between checks, or 0 for none */
+    int days;                       /* Length of the period */
+    guint checks;                   /* Checks expected in the period */
+    guint notifies;                 /* Notifications expected in the period */
+} Period;
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Every check finds a new set of updates, none of them security updates, */
+/* so a notification is due whenever 21 hours - a day less the slack -     */
+/* have passed since the last one. The first period includes the check    */
+/* at startup, and a changed interval runs from the time it is changed    */
+static const Period periods[] =
+{
+    { 24, 180, 181, 181 },
+    { 12,  90, 180,  90 },
+    {  0,  30,   0,   0 },
+    { 24,  65,  65,  65 }
+};
+
+static guint n_notifies;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static Replay *make_result (int n);
+static void notify (gboolean security, gpointer user_data);
+static gboolean expect (const char *what, int period, guint got, guint expected);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+static Replay *make_result (int n)
+{
+    Replay *rep = replay_new ();
+    PkPackage *pkg;
+    char *id;
+    int i;
+
+    for (i = 0; i < 5; i++)
+    {
+        id = g_strdup_printf ("sim-package-%d;%d.0;arm64;debian", i, n);
+        pkg = pk_package_new ();
+        pk_package_set_id (pkg, id, NULL);
+        pk_package_set_info (pkg, PK_INFO_ENUM_NORMAL);
+        pk_package_sack_add_package (rep->sack, pkg);
+        g_object_unref (pkg);
+        g_free (id);
+    }
+    return rep;
+}
+
+static void notify (gboolean, gpointer)
+{
+    n_notifies++;
+}
+
+static gboolean expect (const char *what, int period, guint got, guint expected)
+{
+    if (got == expected) return TRUE;
+    printf ("FAIL: period %d - %u %s, expected %u\n", period, got, what, expected);
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Entry point                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Runs a year of the backend's scheduling on the simulated clock, in steps */
+/* of an hour, and checks the number of checks, notifications and timer     */
+/* wakeups in each period. Checks are replayed with no delay, and each one  */
+/* ends through the GLib main loop before the clock moves on                */
+
+int main (void)
+{
+    static const BackendFuncs funcs = { NULL, notify, NULL };
+    Replay *results[2];
+    Backend *be;
+    guint n_checks, n_errors, last_checks = 0, last_notifies = 0, last_wakeups = 0;
+    gboolean ok = TRUE;
+    int p, hour;
+
+    results[0] = make_result (0);
+    results[1] = make_result (1);
+
+    clock_simulate (g_get_real_time ());
+    be = backend_new (&funcs, NULL);
+
+    for (p = 0; p < (int) G_N_ELEMENTS (periods); p++)
+    {
+        backend_set_interval (be, periods[p].interval);
+        for (hour = 0; hour < periods[p].days * 24; hour++)
+        {
+            /* the next check finds a different set from the last one */
+            backend_get_counts (be, &n_checks, NULL);
+            backend_set_replay (be, replay_copy (results[n_checks % 2]), 0);
+
+            clock_advance (HOUR_US);
+            while (backend_checking (be)) g_main_context_iteration (NULL, TRUE);
+        }
+
+        backend_get_counts (be, &n_checks, &n_errors);
+        printf ("period %d: interval=%dh days=%d checks=%u notifications=%u wakeups=%u\n", p, periods[p].interval, periods[p].days,
+            n_checks - last_checks, n_notifies - last_notifies, clock_wakeups () - last_wakeups);
+
+        /* the scheduler's only timers are the startup idle and the periodic check */
+        ok &= expect ("checks", p, n_checks - last_checks, periods[p].checks);
+        ok &= expect ("notifications", p, n_notifies - last_notifies, periods[p].notifies);
+        ok &= expect ("wakeups", p, clock_wakeups () - last_wakeups, periods[p].checks);
+        ok &= expect ("errors", p, n_errors, 0);
+
+        last_checks = n_checks;
+        last_notifies = n_notifies;
+        last_wakeups = clock_wakeups ();
+    }
+
+    backend_free (be);
+    replay_free (results[0]);
+    replay_free (results[1]);
+    return ok ? 0 : 1;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
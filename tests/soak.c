@@ -0,0 +1,244 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gtk/gtk.h>
+
+#include "backend.h"
+#include "clock.h"
+#include "updates.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+#define SECS_PER_HOUR 3600L
+
+/* Number of distinct replayed results the checks cycle through */
+#define N_RESULTS 8
+
+/* Cycles run before the baseline is taken, so that one-off allocations - */
+/* GLib's type system, thread pools, D-Bus connections - are not counted   */
+#define WARMUP_CYCLES 50
+
+/* Resources are sampled this often, to show the trend in the output - a */
+/* check thread may still be exiting when it is sampled, so one thread of */
+/* growth is allowed by default                                           */
+#define SAMPLE_CYCLES 250
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+static int n_cycles = 2000;
+static int interval = 2;
+static int max_rss_kb = 4096;
+static int max_fds = 0;
+static int max_threads = 1;
+static char *ui_file;
+
+static GOptionEntry entries[] =
+{
+    { "cycles", 'c', 0, G_OPTION_ARG_INT, &n_cycles, "Number of check, dialog and install cycles", "N" },
+    { "interval", 'i', 0, G_OPTION_ARG_INT, &interval, "Simulated hours between checks", "HOURS" },
+    { "max-rss-kb", 0, 0, G_OPTION_ARG_INT, &max_rss_kb, "Allowed growth in resident memory", "KB" },
+    { "max-fds", 0, 0, G_OPTION_ARG_INT, &max_fds, "Allowed growth in open file descriptors", "N" },
+    { "max-threads", 0, 0, G_OPTION_ARG_INT, &max_threads, "Allowed growth in threads", "N" },
+    { "ui", 'u', 0, G_OPTION_ARG_FILENAME, &ui_file, "Dialog definition to load in each cycle, if there is a display", "FILE" },
+    { NULL }
+};
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static Replay *make_result (int n);
+static void wait_for (Backend *be, gboolean (*busy) (Backend *));
+static void open_dialog (Backend *be, gboolean display);
+static void run_cycle (Backend *be, Replay **results, int cycle, gboolean display);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+/* A result with n updates, some of them security updates - each result has */
+/* different versions, so that every check replaces the set and notifies     */
+static Replay *make_result (int n)
+{
+    Replay *rep = replay_new ();
+    PkPackage *pkg;
+    char *id;
+    int i;
+
+    for (i = 0; i < n * 10; i++)
+    {
+        id = g_strdup_printf ("soak-package-%03d;%d.0-%d;arm64;debian", i, n, i);
+        pkg = pk_package_new ();
+        pk_package_set_id (pkg, id, NULL);
+        pk_package_set_info (pkg, i % 5 ? PK_INFO_ENUM_NORMAL : PK_INFO_ENUM_SECURITY);
+        pk_package_sack_add_package (rep->sack, pkg);
+        g_object_unref (pkg);
+        g_free (id);
+    }
+    return rep;
+}
+
+/* Checks end, and installers exit, through the GLib main loop even when */
+/* the scheduler runs on the simulated clock                              */
+static void wait_for (Backend *be, gboolean (*busy) (Backend *))
+{
+    while (busy (be)) g_main_context_iteration (NULL, TRUE);
+}
+
+/* What the plugin's dialog does with the current set - with no display, */
+/* just the list store is filled                                          */
+static void open_dialog (Backend *be, gboolean display)
+{
+    UpdateSet *set = backend_ref_updates (be);
+    GtkListStore *ls = gtk_list_store_new (2, G_TYPE_STRING, G_TYPE_STRING);
+    GtkBuilder *builder;
+    GtkWidget *dlg, *list;
+    char buffer[1024], *ver;
+    int i;
+
+    for (i = 0; i < set->n_updates; i++)
+        if (update_id_split (set->ids[i], buffer, sizeof (buffer), &ver))
+            gtk_list_store_insert_with_values (ls, NULL, -1, 0, buffer, 1, ver, -1);
+
+    if (display && ui_file)
+    {
+        builder = gtk_builder_new_from_file (ui_file);
+        dlg = (GtkWidget *) gtk_builder_get_object (builder, "update_dlg");
+        list = (GtkWidget *) gtk_builder_get_object (builder, "update_list");
+        gtk_tree_view_set_model (GTK_TREE_VIEW (list), GTK_TREE_MODEL (ls));
+        gtk_widget_show_all (dlg);
+        while (gtk_events_pending ()) gtk_main_iteration ();
+        gtk_widget_destroy (dlg);
+        g_object_unref (builder);
+    }
+
+    g_object_unref (ls);
+    update_set_unref (set);
+}
+
+/* One simulated check interval - the periodic check, then the user opens */
+/* the dialog and installs, and the installer exits                       */
+static void run_cycle (Backend *be, Replay **results, int cycle, gboolean display)
+{
+    UpdateSet *set;
+
+    backend_set_replay (be, replay_copy (results[cycle % N_RESULTS]), 0);
+    clock_advance ((gint64) interval * SECS_PER_HOUR * G_USEC_PER_SEC);
+    wait_for (be, backend_checking);
+
+    open_dialog (be, display);
+
+    set = backend_ref_updates (be);
+    backend_install (be, set);
+    update_set_unref (set);
+    wait_for (be, backend_installing);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Entry point                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Runs months of scheduled checks, with the dialog opened and the installer */
+/* run after each, and fails if memory, file descriptors or threads grow by  */
+/* more than the allowed amount. The installer is whatever "gui-updater" is  */
+/* first on the path - the tests put a script there which just exits         */
+
+int main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    Replay *results[N_RESULTS];
+    Backend *be;
+    gboolean display;
+    long rss_kb, base_rss_kb;
+    int n_fds, base_fds, n_threads, base_threads;
+    int i, res = 0;
+
+    context = g_option_context_new (NULL);
+    g_option_context_set_summary (context, "Soak test the check, dialog and install cycle for leaks.");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "soak: %s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return 1;
+    }
+    g_option_context_free (context);
+
+    display = gtk_init_check (&argc, &argv);
+    for (i = 0; i < N_RESULTS; i++) results[i] = make_result (i);
+
+    clock_simulate (g_get_real_time ());
+    be = backend_new (NULL, NULL);
+    backend_set_interval (be, interval);
+
+    for (i = 0; i < WARMUP_CYCLES; i++) run_cycle (be, results, i, display);
+    backend_resources (&base_rss_kb, &base_fds, &base_threads);
+    printf ("baseline rss=%ldkB fds=%d threads=%d display=%s\n", base_rss_kb, base_fds, base_threads, display ? "yes" : "no");
+
+    for (i = 1; i <= n_cycles; i++)
+    {
+        run_cycle (be, results, WARMUP_CYCLES + i, display);
+        if (i % SAMPLE_CYCLES) continue;
+
+        backend_resources (&rss_kb, &n_fds, &n_threads);
+        printf ("cycle %d (%ld days) rss=%ldkB fds=%d threads=%d\n", i, (long) i * interval / 24, rss_kb, n_fds, n_threads);
+    }
+    backend_resources (&rss_kb, &n_fds, &n_threads);
+    printf ("end rss=%ldkB fds=%d threads=%d\n", rss_kb, n_fds, n_threads);
+
+    if (rss_kb - base_rss_kb > max_rss_kb)
+    {
+        printf ("FAIL: resident memory grew by %ldkB\n", rss_kb - base_rss_kb);
+        res = 1;
+    }
+    if (n_fds - base_fds > max_fds)
+    {
+        printf ("FAIL: open file descriptors grew by %d\n", n_fds - base_fds);
+        res = 1;
+    }
+    if (n_threads - base_threads > max_threads)
+    {
+        printf ("FAIL: threads grew by %d\n", n_threads - base_threads);
+        res = 1;
+    }
+
+    backend_free (be);
+    for (i = 0; i < N_RESULTS; i++) replay_free (results[i]);
+    return res;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
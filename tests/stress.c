@@ -0,0 +1,335 @@
+/*============================================================================
+Copyright (c) 2025 Raspberry Pi Holdings Ltd.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gtk/gtk.h>
+
+#include "updater.h"
+#include "backend.h"
+#include "check.h"
+
+/*----------------------------------------------------------------------------*/
+/* Typedefs and macros                                                        */
+/*----------------------------------------------------------------------------*/
+
+/* Recorded duration of each call of the replayed check - with the default */
+/* speed, a check takes a few milliseconds, so that operations land while   */
+/* its thread is running as well as between checks                         */
+#define CALL_US 20000
+
+/* Most plugin instances alive at once - as on a desktop with several panels */
+#define MAX_VIEWS 4
+
+typedef enum
+{
+    OP_CREATE,
+    OP_CHECK,
+    OP_CANCEL,
+    OP_INTERVAL,
+    OP_DESTROY,
+    OP_CONTROL,
+    OP_VIEW_ADD,
+    OP_VIEW_REMOVE,
+    OP_DISPATCH,
+    OP_SLEEP,
+    N_OPS
+} Op;
+
+/*----------------------------------------------------------------------------*/
+/* Global data                                                                */
+/*----------------------------------------------------------------------------*/
+
+static int n_ops = 20000;
+static int seed;
+static double speed = 10.0;
+static gboolean mock;
+
+static GOptionEntry entries[] =
+{
+    { "ops", 'n', 0, G_OPTION_ARG_INT, &n_ops, "Number of operations to run", "N" },
+    { "seed", 's', 0, G_OPTION_ARG_INT, &seed, "Seed for the order of operations, or 0 for a random one", "SEED" },
+    { "speed", 0, 0, G_OPTION_ARG_DOUBLE, &speed, "Speed-up factor for the replayed checks", "FACTOR" },
+    { "mock", 'm', 0, G_OPTION_ARG_NONE, &mock, "Check against PackageKit on the bus, normally the mock, instead of replaying", NULL },
+    { NULL }
+};
+
+/* Control messages, as sent by lxpanelctl or wfpanelctl - "record" is */
+/* completed with a path in the runtime directory                     */
+static const char *commands[] = { "check", "check --no-refresh", "cancel", "status", "json", "stats",
+    "log-level debug", "log-level info", "log-journal off", "log", "record" };
+
+/* Plugin instances, as the panels would create them */
+static GPtrArray *views;
+static char *record_path;
+
+/*----------------------------------------------------------------------------*/
+/* Prototypes                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static Replay *make_result (void);
+static Backend *create (const Replay *rep);
+static void control (GRand *rand, Backend *be);
+static void view_add (GRand *rand);
+static void view_remove (GRand *rand);
+static void quiet (const gchar *, GLogLevelFlags, const gchar *, gpointer);
+
+/*----------------------------------------------------------------------------*/
+/* Function definitions                                                       */
+/*----------------------------------------------------------------------------*/
+
+static Replay *make_result (void)
+{
+    Replay *rep = replay_new ();
+    PkPackage *pkg;
+    char *id;
+    int i;
+
+    rep->refresh_us = CALL_US;
+    rep->query_us = CALL_US;
+    for (i = 0; i < 50; i++)
+    {
+        id = g_strdup_printf ("stress-package-%d;1.0;arm64;debian", i);
+        pkg = pk_package_new ();
+        pk_package_set_id (pkg, id, NULL);
+        pk_package_set_info (pkg, i % 4 ? PK_INFO_ENUM_NORMAL : PK_INFO_ENUM_SECURITY);
+        pk_package_sack_add_package (rep->sack, pkg);
+        g_object_unref (pkg);
+        g_free (id);
+    }
+    return rep;
+}
+
+static Backend *create (const Replay *rep)
+{
+    Backend *be = backend_new (NULL, NULL);
+
+    if (!mock) backend_set_replay (be, replay_copy (rep), speed);
+    return be;
+}
+
+/* A control message goes to one of the plugin instances, which all control */
+/* the backend they share, or to the stand-alone backend through an        */
+/* instance with no view - updater_control_msg only uses the backend       */
+static void control (GRand *rand, Backend *be)
+{
+    UpdaterPlugin bare, *up;
+    const char *cmd;
+    char *full = NULL;
+
+    if (views->len && (!be || g_rand_boolean (rand)))
+        up = (UpdaterPlugin *) g_ptr_array_index (views, g_rand_int_range (rand, 0, views->len));
+    else
+    {
+        memset (&bare, 0, sizeof (UpdaterPlugin));
+        bare.be = be;
+        up = &bare;
+    }
+
+    cmd = commands[g_rand_int_range (rand, 0, G_N_ELEMENTS (commands))];
+    if (!strcmp (cmd, "record")) cmd = full = g_strdup_printf ("record %s", record_path);
+    updater_control_msg (up, cmd);
+    g_free (full);
+}
+
+/* The first instance creates the plugin's backend, which replays the same */
+/* check as the stand-alone one, unless checking against the mock         */
+static void view_add (GRand *rand)
+{
+    UpdaterPlugin *up = g_new0 (UpdaterPlugin, 1);
+
+    up->plugin = gtk_button_new ();
+    g_object_ref_sink (up->plugin);
+    up->icon_size = 24;
+    up->interval = g_rand_int_range (rand, 0, 48);
+    updater_init (up);
+    g_ptr_array_add (views, up);
+}
+
+/* Destroyed as the panel does, whatever is pending - the view's idle    */
+/* initialisation, a check which will call back into the remaining views, */
+/* or the backend's timers once the last view has gone                   */
+static void view_remove (GRand *rand)
+{
+    UpdaterPlugin *up = (UpdaterPlugin *) g_ptr_array_remove_index (views, g_rand_int_range (rand, 0, views->len));
+    GtkWidget *plugin = up->plugin;
+
+    updater_destructor (up);
+    gtk_widget_destroy (plugin);
+    g_object_unref (plugin);
+}
+
+/* Stats are written to the journal as well as the reply file - thousands */
+/* of them would bury the output                                          */
+static void quiet (const gchar *, GLogLevelFlags, const gchar *, gpointer)
+{
+}
+
+/*----------------------------------------------------------------------------*/
+/* Entry point                                                                */
+/*----------------------------------------------------------------------------*/
+
+/* Runs checks, cancels, interval changes, control messages, and creation  */
+/* and destruction of the backend and of plugin instances in a random      */
+/* order, with the main loop dispatched at random points, so that each     */
+/* happens both while a check is running and while it is idle. Checks are  */
+/* replayed on threads, or run against the mock PackageKit with --mock.    */
+/* Plugin instances need a display, and are left out without one. It only  */
+/* fails by itself if the process crashes or a check never ends - the      */
+/* stress-tsan build has data races fail it too                            */
+
+int main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    Replay *rep;
+    Backend *be;
+    GRand *rand;
+    guint counts[N_OPS] = { 0 };
+    gint64 deadline;
+    gboolean display;
+    char *path, buf[G_ASCII_DTOSTR_BUF_SIZE];
+    int i, n;
+
+    context = g_option_context_new (NULL);
+    g_option_context_set_summary (context, "Stress the asynchronous check paths with operations in a random order.");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "stress: %s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return 1;
+    }
+    g_option_context_free (context);
+
+    display = gtk_init_check (NULL, NULL);
+    g_log_set_handler (NULL, G_LOG_LEVEL_MESSAGE, quiet, NULL);
+
+    if (!seed) seed = g_random_int_range (1, G_MAXINT);
+    printf ("seed %d, %s checks, %s\n", seed, mock ? "mock" : "replayed", display ? "with views" : "no display for views");
+    rand = g_rand_new_with_seed (seed);
+    rep = make_result ();
+    views = g_ptr_array_new ();
+    record_path = g_build_filename (g_get_user_runtime_dir (), "stress-record", NULL);
+
+    /* the plugin's backend loads its replay from a file */
+    if (!mock)
+    {
+        path = g_build_filename (g_get_user_runtime_dir (), "stress-replay", NULL);
+        replay_save (path, rep);
+        g_setenv ("UPDATER_REPLAY", path, TRUE);
+        g_setenv ("UPDATER_REPLAY_SPEED", g_ascii_dtostr (buf, sizeof (buf), speed), TRUE);
+        g_free (path);
+    }
+
+    be = create (rep);
+
+    for (i = 0; i < n_ops; i++)
+    {
+        Op op = g_rand_int_range (rand, 0, N_OPS);
+
+        /* without a display, control messages stand in for the view operations */
+        if (!display && (op == OP_VIEW_ADD || op == OP_VIEW_REMOVE)) op = OP_CONTROL;
+        if (op == OP_VIEW_ADD && views->len >= MAX_VIEWS) op = OP_VIEW_REMOVE;
+        if (op == OP_VIEW_REMOVE && !views->len) op = OP_VIEW_ADD;
+
+        /* operations on the stand-alone backend need it to exist */
+        if (!be && op >= OP_CHECK && op <= OP_DESTROY) op = OP_CREATE;
+        if (!be && op == OP_CONTROL && !views->len) op = OP_CREATE;
+        counts[op]++;
+
+        switch (op)
+        {
+            case OP_CREATE:     if (!be) be = create (rep);
+                                break;
+
+            case OP_CHECK:      backend_check (be, g_rand_boolean (rand));
+                                break;
+
+            case OP_CANCEL:     backend_cancel (be);
+                                break;
+
+            case OP_INTERVAL:   backend_set_interval (be, g_rand_int_range (rand, 0, 48));
+                                if (views->len)
+                                {
+                                    UpdaterPlugin *up = (UpdaterPlugin *) g_ptr_array_index (views, g_rand_int_range (rand, 0, views->len));
+                                    up->interval = g_rand_int_range (rand, 0, 48);
+                                    updater_set_options (up);
+                                }
+                                break;
+
+            case OP_DESTROY:    backend_free (be);
+                                be = NULL;
+                                break;
+
+            case OP_CONTROL:    control (rand, be);
+                                break;
+
+            case OP_VIEW_ADD:   view_add (rand);
+                                break;
+
+            case OP_VIEW_REMOVE:
+                                view_remove (rand);
+                                break;
+
+            case OP_DISPATCH:   n = g_rand_int_range (rand, 1, 4);
+                                while (n-- && g_main_context_iteration (NULL, FALSE));
+                                break;
+
+            case OP_SLEEP:      g_usleep (g_rand_int_range (rand, 0, 2000));
+                                break;
+
+            default:            break;
+        }
+    }
+
+    printf ("create=%u check=%u cancel=%u interval=%u destroy=%u control=%u view-add=%u view-remove=%u dispatch=%u sleep=%u\n",
+        counts[OP_CREATE], counts[OP_CHECK], counts[OP_CANCEL], counts[OP_INTERVAL], counts[OP_DESTROY], counts[OP_CONTROL],
+        counts[OP_VIEW_ADD], counts[OP_VIEW_REMOVE], counts[OP_DISPATCH], counts[OP_SLEEP]);
+
+    /* checks detached by destroying the backend still end, and free themselves */
+    while (views->len) view_remove (rand);
+    if (be) backend_free (be);
+    deadline = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+    while (check_count () && g_get_monotonic_time () < deadline)
+    {
+        if (!g_main_context_iteration (NULL, FALSE)) g_usleep (1000);
+    }
+
+    n = check_count ();
+    if (n) printf ("FAIL: %d checks did not end\n", n);
+    g_ptr_array_free (views, TRUE);
+    g_free (record_path);
+    replay_free (rep);
+    g_rand_free (rand);
+    return n ? 1 : 0;
+}
+
+/* End of file */
+/*----------------------------------------------------------------------------*/
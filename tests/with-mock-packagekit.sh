@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# Runs a command against the mock PackageKit daemon, on a private bus which
+# the command sees as both its system and session bus, with its runtime and
+# cache directories in a scratch directory - results are shared there, not
+# in the system-wide directory. The mock is named by
+# MOCK_PACKAGEKIT, and its options are taken from MOCK_PACKAGEKIT_ARGS.
+#
+#   with-mock-packagekit.sh COMMAND [ARGS...]
+
+set -e
+
+tmp=$(mktemp -d)
+bus_pid=
+mock_pid=
+trap 'kill $mock_pid $bus_pid 2>/dev/null; rm -rf "$tmp"' EXIT
+
+bus=$(dbus-daemon --session --fork --print-address=1 --print-pid=1)
+bus_pid=$(echo "$bus" | sed -n 2p)
+DBUS_SYSTEM_BUS_ADDRESS=$(echo "$bus" | sed -n 1p)
+DBUS_SESSION_BUS_ADDRESS=$DBUS_SYSTEM_BUS_ADDRESS
+XDG_RUNTIME_DIR=$tmp
+XDG_CACHE_HOME=$tmp
+UPDATER_SHARED_DIR=
+export DBUS_SYSTEM_BUS_ADDRESS DBUS_SESSION_BUS_ADDRESS XDG_RUNTIME_DIR XDG_CACHE_HOME UPDATER_SHARED_DIR
+
+# shellcheck disable=SC2086
+"$MOCK_PACKAGEKIT" $MOCK_PACKAGEKIT_ARGS &
+mock_pid=$!
+
+tries=0
+until gdbus call --system --dest org.freedesktop.DBus --object-path /org/freedesktop/DBus \
+        --method org.freedesktop.DBus.NameHasOwner org.freedesktop.PackageKit 2>/dev/null | grep -q true
+do
+    tries=$((tries + 1))
+    if [ $tries -ge 50 ]; then
+        echo "with-mock-packagekit: mock daemon did not start" >&2
+        exit 1
+    fi
+    sleep 0.1
+done
+
+"$@"